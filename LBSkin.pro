@@ -16,19 +16,35 @@ SOURCES += \
     src/MainWindow.cpp \
     src/GLWindow.cpp \
     src/SkinDeformer.cpp \
+    src/SkinCrowd.cpp \
     src/SceneLoader.cpp \
     src/AIUtil.cpp \
-    src/Dualquaternion.cpp
+    src/Dualquaternion.cpp \
+    src/WorkerPool.cpp \
+    src/SkinKernels.cpp \
+    src/AnimClip.cpp \
+    src/AssetCache.cpp \
+    src/RigGenerator.cpp \
+    src/FrameProfiler.cpp \
+    src/TraceRecorder.cpp
 
 HEADERS += \
     include/MainWindow.h \
     include/GLWindow.h \
     include/SkinDeformer.h \
+    include/SkinCrowd.h \
     include/SceneLoader.h \
     include/DataTypes.h \
     include/AIUtil.h \
     include/Dualquaternion.h \
-    include/Util.h
+    include/Util.h \
+    include/WorkerPool.h \
+    include/SkinKernels.h \
+    include/AnimClip.h \
+    include/AssetCache.h \
+    include/RigGenerator.h \
+    include/FrameProfiler.h \
+    include/TraceRecorder.h
 
 FORMS += \
     ui/MainWindow.ui
@@ -46,7 +62,7 @@ OTHER_FILES+= \
     shaders/DiffuseVertex.glsl \
     shaders/DiffuseFragment.glsl
 
-CONFIG += console
+CONFIG += console c++11
 CONFIG -= app_bundle
 INCLUDEPATH+=./include
 
@@ -67,6 +83,8 @@ LIBS+=-lassimp
 LIBS +=  -L/$(HOME)/NGL/lib -l NGL
 
 unix:LIBS += -L/usr/local/lib
+# the skinning worker threads
+unix:LIBS += -pthread
 # add the ngl lib
 
 
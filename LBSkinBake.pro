@@ -0,0 +1,57 @@
+TARGET=LBSkinBake
+OBJECTS_DIR=obj_bake
+# headless tool that bakes scene files into the binary cache read by LBSkin
+# it has no window,Qt is only linked because NGL needs it
+isEqual(QT_MAJOR_VERSION, 5) {
+    cache()
+    DEFINES +=QT5BUILD
+}
+
+CONFIG-=app_bundle
+QT+=gui opengl core
+
+SOURCES += \
+    src/BakeMain.cpp \
+    src/SceneLoader.cpp \
+    src/AIUtil.cpp \
+    src/WorkerPool.cpp \
+    src/AnimClip.cpp \
+    src/AssetCache.cpp \
+    src/RigGenerator.cpp \
+    src/TraceRecorder.cpp
+
+HEADERS += \
+    include/SceneLoader.h \
+    include/DataTypes.h \
+    include/AIUtil.h \
+    include/WorkerPool.h \
+    include/AnimClip.h \
+    include/AssetCache.h \
+    include/RigGenerator.h \
+    include/TraceRecorder.h
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+INCLUDEPATH+=./include
+
+QMAKE_CXXFLAGS_WARN_ON +=  "-Wno-unused-parameter"
+QMAKE_CXXFLAGS+= -msse -msse2 -msse3
+macx:QMAKE_CXXFLAGS+= -arch x86_64
+macx:INCLUDEPATH+=/usr/local/include/
+
+LIBS += -L/usr/local/lib
+LIBS+=-lassimp
+# add the ngl lib
+LIBS +=  -L/$(HOME)/NGL/lib -l NGL
+# the bake worker threads
+unix:LIBS += -pthread
+
+linux-*{
+    linux-*:QMAKE_CXXFLAGS +=  -march=native
+    linux-*:DEFINES+=GL42
+    DEFINES += LINUX
+}
+
+DEPENDPATH+=include
+macx:DEFINES += DARWIN
+INCLUDEPATH += $$(HOME)/NGL/include/
@@ -0,0 +1,69 @@
+TARGET=LBSkinBench
+OBJECTS_DIR=obj_bench
+# headless skinning benchmark,writes per stage timings as csv
+# it has no window,Qt and GL are only linked because NGL needs them
+isEqual(QT_MAJOR_VERSION, 5) {
+    cache()
+    DEFINES +=QT5BUILD
+}
+
+CONFIG-=app_bundle
+QT+=gui opengl core
+
+SOURCES += \
+    src/BenchMain.cpp \
+    src/SkinDeformer.cpp \
+    src/SkinCrowd.cpp \
+    src/SceneLoader.cpp \
+    src/AIUtil.cpp \
+    src/Dualquaternion.cpp \
+    src/WorkerPool.cpp \
+    src/SkinKernels.cpp \
+    src/AnimClip.cpp \
+    src/AssetCache.cpp \
+    src/RigGenerator.cpp \
+    src/TraceRecorder.cpp
+
+HEADERS += \
+    include/SkinDeformer.h \
+    include/SkinCrowd.h \
+    include/SceneLoader.h \
+    include/DataTypes.h \
+    include/AIUtil.h \
+    include/Dualquaternion.h \
+    include/Util.h \
+    include/WorkerPool.h \
+    include/SkinKernels.h \
+    include/AnimClip.h \
+    include/AssetCache.h \
+    include/RigGenerator.h \
+    include/TraceRecorder.h
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+INCLUDEPATH+=./include
+
+QMAKE_CXXFLAGS_WARN_ON +=  "-Wno-unused-parameter"
+# the benchmark is only meaningful optimised
+CONFIG += release
+CONFIG -= debug
+QMAKE_CXXFLAGS+= -msse -msse2 -msse3
+macx:QMAKE_CXXFLAGS+= -arch x86_64
+macx:INCLUDEPATH+=/usr/local/include/
+
+LIBS += -L/usr/local/lib
+LIBS+=-lassimp
+# add the ngl lib
+LIBS +=  -L/$(HOME)/NGL/lib -l NGL
+# the skinning worker threads
+unix:LIBS += -pthread
+
+linux-*{
+    linux-*:QMAKE_CXXFLAGS +=  -march=native
+    linux-*:DEFINES+=GL42
+    DEFINES += LINUX
+}
+
+DEPENDPATH+=include
+macx:DEFINES += DARWIN
+INCLUDEPATH += $$(HOME)/NGL/include/
@@ -0,0 +1,189 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AnimClip.h
+/// @brief a compact animation clip resampled at a fixed rate
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+/// @class AnimClip
+/// @brief every animated node becomes a track of position,rotation and scale sampled at
+/// the same fixed rate,so finding the two samples to blend is an index computation.
+/// rotations are stored as 16 bit normalised quaternions,positions and scales as 16 bit
+/// values inside the range of the track,and a track that does not change is stored once.
+/// sampling a constant track uses a stride of 0 so it takes the same path as an animated one
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef ANIMCLIP_H
+#define ANIMCLIP_H
+
+#include<vector>
+
+#include<ngl/Vec3.h>
+#include<ngl/Quaternion.h>
+
+class AssetCacheWriter;
+class AssetCacheReader;
+
+class AnimClip
+{
+public:
+  //-----------------------------------------------
+  /// @brief constructor,an empty clip
+  //---------------------------------------------------
+  AnimClip();
+
+  //-----------------------------------------------
+  /// @brief remove all tracks and samples
+  //---------------------------------------------------
+  void clear();
+
+  //-----------------------------------------------
+  /// @brief start a new clip,the tracks are then filled with setTrack
+  /// @param[in] _duration length of the clip in ticks
+  /// @param[in] _sampleRate samples per tick,raised slightly so the samples divide the duration exactly
+  /// @param[in] _nTracks number of animated nodes
+  //---------------------------------------------------
+  void begin(float _duration, float _sampleRate, unsigned int _nTracks);
+
+  //-----------------------------------------------
+  /// @brief store one track,each array holds numFrames() samples.
+  /// the rotations are flipped where needed so neighbouring samples are in the same hemisphere
+  /// @param[in] _track track index
+  /// @param[in] _pos position samples
+  /// @param[in] _rot rotation samples
+  /// @param[in] _scale scale samples
+  //---------------------------------------------------
+  void setTrack(
+                 unsigned int _track,
+                 const std::vector<ngl::Vec3> &_pos,
+                 const std::vector<ngl::Quaternion> &_rot,
+                 const std::vector<ngl::Vec3> &_scale
+               );
+
+  //-----------------------------------------------
+  /// @brief interpolate a track at a time
+  /// @param[in] _track track index
+  /// @param[in] _time time in ticks,clamped to the clip
+  /// @param[out] o_pos position
+  /// @param[out] o_rot unit rotation
+  /// @param[out] o_scale scale
+  //---------------------------------------------------
+  void sample(unsigned int _track, float _time, ngl::Vec3 &o_pos, ngl::Quaternion &o_rot, ngl::Vec3 &o_scale) const;
+
+  //-----------------------------------------------
+  /// @brief accessor for the length of the clip in ticks
+  //---------------------------------------------------
+  inline float duration() const { return m_duration;}
+  //-----------------------------------------------
+  /// @brief accessor for the number of samples per tick
+  //---------------------------------------------------
+  inline float sampleRate() const { return m_sampleRate;}
+  //-----------------------------------------------
+  /// @brief accessor for the number of samples in an animated track
+  //---------------------------------------------------
+  inline unsigned int numFrames() const { return m_nFrames;}
+  //-----------------------------------------------
+  /// @brief accessor for the number of tracks
+  //---------------------------------------------------
+  inline unsigned int numTracks() const { return m_tracks.size();}
+  //-----------------------------------------------
+  /// @brief the time in ticks of a sample
+  /// @param[in] _frame sample index
+  //---------------------------------------------------
+  inline float frameTime(unsigned int _frame) const { return _frame / m_sampleRate;}
+  //-----------------------------------------------
+  /// @brief bytes used by the tracks and samples
+  //---------------------------------------------------
+  unsigned int memorySize() const;
+
+  //-----------------------------------------------
+  /// @brief append the clip to a cache
+  //---------------------------------------------------
+  void write(AssetCacheWriter &_cache) const;
+  //-----------------------------------------------
+  /// @brief replace the clip with one read from a cache
+  /// @returns false if the cache did not hold a valid clip,the clip is then empty
+  //---------------------------------------------------
+  bool read(AssetCacheReader &_cache);
+
+  //-----------------------------------------------
+  /// @brief a position or scale channel,value = m_min + sample * m_step
+  //---------------------------------------------------
+  struct vecChannel
+  {
+    //------------------
+    /// @brief index of the first sample in m_vecData
+    //--------------------
+    unsigned int m_offset;
+    //------------------
+    /// @brief distance between two samples,0 for a constant channel
+    //--------------------
+    unsigned int m_stride;
+    //------------------
+    /// @brief smallest value of each component
+    //--------------------
+    float m_min[3];
+    //------------------
+    /// @brief size of one quantisation step of each component
+    //--------------------
+    float m_step[3];
+  };
+
+  //-----------------------------------------------
+  /// @brief the position,rotation and scale of one animated node
+  //---------------------------------------------------
+  struct clipTrack
+  {
+    //------------------
+    /// @brief index of the first rotation sample in m_rotData
+    //--------------------
+    unsigned int m_rotOffset;
+    //------------------
+    /// @brief distance between two rotation samples,0 for a constant rotation
+    //--------------------
+    unsigned int m_rotStride;
+    //------------------
+    /// @brief position channel
+    //--------------------
+    vecChannel m_pos;
+    //------------------
+    /// @brief scale channel
+    //--------------------
+    vecChannel m_scale;
+  };
+
+private:
+  //-----------------------------------------------
+  /// @brief quantise a position or scale channel into m_vecData
+  //---------------------------------------------------
+  void storeChannel(const std::vector<ngl::Vec3> &_values, vecChannel &o_channel);
+  //-----------------------------------------------
+  /// @brief interpolate a position or scale channel
+  //---------------------------------------------------
+  ngl::Vec3 sampleChannel(const vecChannel &_channel, unsigned int _i0, unsigned int _i1, float _t) const;
+
+  //-----------------------------------------------
+  /// @brief length of the clip in ticks
+  //---------------------------------------------------
+  float m_duration;
+  //-----------------------------------------------
+  /// @brief samples per tick
+  //---------------------------------------------------
+  float m_sampleRate;
+  //-----------------------------------------------
+  /// @brief number of samples of an animated track
+  //---------------------------------------------------
+  unsigned int m_nFrames;
+  //-----------------------------------------------
+  /// @brief one entry per animated node
+  //---------------------------------------------------
+  std::vector<clipTrack> m_tracks;
+  //-----------------------------------------------
+  /// @brief rotation samples,x,y,z,w as 16 bit normalised values
+  //---------------------------------------------------
+  std::vector<short> m_rotData;
+  //-----------------------------------------------
+  /// @brief position and scale samples,x,y,z as 16 bit steps from the channel minimum
+  //---------------------------------------------------
+  std::vector<unsigned short> m_vecData;
+};
+
+#endif // ANIMCLIP_H
@@ -0,0 +1,186 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AssetCache.h
+/// @brief a binary cache of an imported scene so assimp only runs the first time a file is loaded
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+/// @class AssetCacheWriter
+/// @brief collects values and arrays in memory and writes them to disk in one go.
+/// the file starts with a header holding the hash of the source file it was made from
+/// @class AssetCacheReader
+/// @brief memory maps a cache file and copies the arrays straight out of the mapping,
+/// nothing is parsed.a value or array read in the wrong order or with a different element
+/// size fails the read so an out of date file is never half loaded
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include<vector>
+#include<string>
+#include<cstring>
+#include<stdint.h>
+
+namespace AssetCache
+{
+  //-----------------------------------------------
+  /// @brief 64 bit FNV-1a hash of the contents of a file
+  /// @param[in] _fname file to hash
+  /// @param[out] o_hash the hash
+  /// @returns false if the file could not be read
+  //---------------------------------------------------
+  bool hashFile(const std::string &_fname, uint64_t &o_hash);
+
+  //-----------------------------------------------
+  /// @brief the name of the cache file kept next to a source file,a cache only holds one
+  /// set of import settings so they are part of the name and each set gets its own file
+  /// @param[in] _fname source file
+  /// @param[in] _settings short tag of the import settings
+  //---------------------------------------------------
+  inline std::string cachePath(const std::string &_fname, const std::string &_settings)
+  {
+    return _fname + "." + _settings + ".lbcache";
+  }
+}
+
+class AssetCacheWriter
+{
+public:
+  //-----------------------------------------------
+  /// @brief start a cache for a source file
+  /// @param[in] _sourceHash hash of the source file
+  //---------------------------------------------------
+  AssetCacheWriter(uint64_t _sourceHash);
+
+  //-----------------------------------------------
+  /// @brief append a single value,it must be safe to copy with memcpy
+  //---------------------------------------------------
+  template <typename T>
+  void writeValue(const T &_value)
+  {
+    append(&_value, sizeof(T));
+  }
+
+  //-----------------------------------------------
+  /// @brief append the element size,count and contents of an array
+  //---------------------------------------------------
+  template <typename T>
+  void writeArray(const std::vector<T> &_array)
+  {
+    uint32_t elementSize = sizeof(T);
+    uint32_t count = _array.size();
+    writeValue(elementSize);
+    writeValue(count);
+    if (count) {
+      append(&_array[0], count * sizeof(T));
+    }
+  }
+
+  //-----------------------------------------------
+  /// @brief write everything to a file,a temporary file is renamed at the end
+  /// so a reader never sees a partly written cache
+  /// @param[in] _fname cache file
+  //---------------------------------------------------
+  bool save(const std::string &_fname) const;
+
+private:
+  //-----------------------------------------------
+  /// @brief append raw bytes to m_data
+  //---------------------------------------------------
+  void append(const void *_data, size_t _size);
+  //-----------------------------------------------
+  /// @brief the header followed by every value and array in order
+  //---------------------------------------------------
+  std::vector<char> m_data;
+};
+
+class AssetCacheReader
+{
+public:
+  //-----------------------------------------------
+  /// @brief constructor,nothing is mapped
+  //---------------------------------------------------
+  AssetCacheReader();
+  //-----------------------------------------------
+  /// @brief destructor,unmaps the file
+  //---------------------------------------------------
+  ~AssetCacheReader();
+
+  //-----------------------------------------------
+  /// @brief map a cache file and check its header
+  /// @param[in] _fname cache file
+  /// @param[in] _sourceHash hash of the source file the cache must have been made from
+  /// @returns false if there is no cache,it is from another version or the source has changed
+  //---------------------------------------------------
+  bool open(const std::string &_fname, uint64_t _sourceHash);
+
+  //-----------------------------------------------
+  /// @brief unmap the file
+  //---------------------------------------------------
+  void close();
+
+  //-----------------------------------------------
+  /// @brief read the next value
+  //---------------------------------------------------
+  template <typename T>
+  bool readValue(T &o_value)
+  {
+    const char *src = take(sizeof(T));
+    if (!src) {
+      return false;
+    }
+    memcpy(&o_value, src, sizeof(T));
+    return true;
+  }
+
+  //-----------------------------------------------
+  /// @brief read the next array,fails if it was written with a different element type size
+  //---------------------------------------------------
+  template <typename T>
+  bool readArray(std::vector<T> &o_array)
+  {
+    uint32_t elementSize, count;
+    if (!readValue(elementSize) || !readValue(count) || elementSize != sizeof(T)) {
+      m_failed = true;
+      return false;
+    }
+    const char *src = take((size_t)count * sizeof(T));
+    if (!src) {
+      return false;
+    }
+    o_array.resize(count);
+    if (count) {
+      memcpy(&o_array[0], src, (size_t)count * sizeof(T));
+    }
+    return true;
+  }
+
+  //-----------------------------------------------
+  /// @brief true if any read has failed since open
+  //---------------------------------------------------
+  inline bool failed() const { return m_failed;}
+
+private:
+  //-----------------------------------------------
+  /// @brief step over _size bytes of the mapping
+  /// @returns the start of the bytes or NULL past the end of the file
+  //---------------------------------------------------
+  const char *take(size_t _size);
+  //-----------------------------------------------
+  /// @brief the mapped file
+  //---------------------------------------------------
+  const char *m_data;
+  //-----------------------------------------------
+  /// @brief size of the mapping in bytes
+  //---------------------------------------------------
+  size_t m_size;
+  //-----------------------------------------------
+  /// @brief offset of the next read
+  //---------------------------------------------------
+  size_t m_offset;
+  //-----------------------------------------------
+  /// @brief set when a read runs past the end or does not match
+  //---------------------------------------------------
+  bool m_failed;
+};
+
+#endif // ASSETCACHE_H
@@ -13,6 +13,7 @@
 #include<vector>
 #include<string>
 #include<iostream>
+#include<algorithm>
 
 #include<ngl/Mat4.h>
 #include<ngl/Vec3.h>
@@ -67,6 +68,11 @@ struct boneInfo
     /// for this project i have not coded for multiple parents
     //--------------------
     int m_parentBoneId;
+    //------------------
+    /// @brief next entry driven by the same node,-1 for the last.a bone used by meshes with
+    /// different bind poses has one entry per bind pose chained from the first
+    //--------------------
+    int m_nextBone;
 
 };
 
@@ -98,10 +104,6 @@ struct vertexBoneInfo
     /// usually adding all weights will equal to 1
     //--------------------
     std::vector<ngl::Real> m_skinWeights;
-    //------------------
-    /// @brief the end weights pre vertex
-    //--------------------
-    std::vector<ngl::Real> m_endWeights;
 
     //-----------------------------------------------
     /// @brief member function to add the bone data and increment the number of weights
@@ -112,13 +114,251 @@ struct vertexBoneInfo
     {
         m_boneIds.push_back(BoneID);
         m_skinWeights.push_back(Weight);
-        m_endWeights.push_back(Weight);
         m_nWeights++;
     }
 
+    //-----------------------------------------------
+    /// @brief put the heaviest bone first and the others in bone id order,so vertices
+    /// with the same dominant bone and bone set store them in the same order
+    //---------------------------------------------------
+    void sortInfluences()
+    {
+        if(m_nWeights<2)
+            return;
+        int heaviest=0;
+        for(int i=1; i<m_nWeights; ++i)
+        {
+            if(m_skinWeights[i]>m_skinWeights[heaviest])
+                heaviest=i;
+        }
+        std::swap(m_skinWeights[0],m_skinWeights[heaviest]);
+        std::swap(m_boneIds[0],m_boneIds[heaviest]);
+        for(int i=2; i<m_nWeights; ++i)
+        {
+            for(int j=i; j>1 && m_boneIds[j]<m_boneIds[j-1]; --j)
+            {
+                std::swap(m_skinWeights[j],m_skinWeights[j-1]);
+                std::swap(m_boneIds[j],m_boneIds[j-1]);
+            }
+        }
+    }
+
+    //-----------------------------------------------
+    /// @brief drop the smallest weights until at most _max bones are left
+    /// and scale the remaining weights so they add up to 1 again
+    ///@param[in] _max number of bones to keep
+    //---------------------------------------------------
+    void limitInfluences(unsigned int _max)
+    {
+        if(_max==0 || (unsigned int)m_nWeights<=_max)
+            return;
+        while((unsigned int)m_nWeights>_max)
+        {
+            int smallest=0;
+            for(int i=1; i<m_nWeights; ++i)
+            {
+                if(m_skinWeights[i]<m_skinWeights[smallest])
+                    smallest=i;
+            }
+            m_boneIds.erase(m_boneIds.begin()+smallest);
+            m_skinWeights.erase(m_skinWeights.begin()+smallest);
+            m_nWeights--;
+        }
+        ngl::Real total=0;
+        for(int i=0; i<m_nWeights; ++i)
+            total+=m_skinWeights[i];
+        if(total>0)
+        {
+            for(int i=0; i<m_nWeights; ++i)
+                m_skinWeights[i]/=total;
+        }
+    }
+
 };
 
+//-----------------------------------------------
+/// @brief packed skinning influences for the whole mesh stored as a structure of arrays
+/// every vertex owns m_maxInfluences slots and slot k of vertex v is stored at
+/// k*m_nVerts+v, so consecutive vertices of the same slot are next to each other in memory.
+/// unused slots have a weight of 0 and point at bone 0 so they are safe to read.
+/// bone ids are stored in the fewest bytes that hold the largest id (1,2 or 4) and weights
+/// as floats or as 16 or 8 bit fractions of 1,so a 4 bone vertex takes 8 bytes instead of 32.
+/// it is built once at load time from the vertexBoneInfo data and read by reference
+/// by the deformers every frame
+//---------------------------------------------------
+struct skinInfluences
+{
+    //-----------------------------------------------
+    /// @brief constructor
+    //---------------------------------------------------
+    skinInfluences()
+    {
+        m_nVerts=0;
+        m_maxInfluences=0;
+        m_idBytes=4;
+        m_weightBytes=4;
+    }
+    //------------------
+    /// @brief number of vertices in the table
+    //--------------------
+    unsigned int m_nVerts;
+    //------------------
+    /// @brief number of slots stored per vertex,the largest influence count in the mesh
+    //--------------------
+    unsigned int m_maxInfluences;
+    //------------------
+    /// @brief size of a stored bone id,1 2 or 4 bytes
+    //--------------------
+    unsigned int m_idBytes;
+    //------------------
+    /// @brief size of a stored weight,4 for floats,2 or 1 for fractions of 65535 or 255
+    //--------------------
+    unsigned int m_weightBytes;
+    //------------------
+    /// @brief number of used slots per vertex
+    //--------------------
+    std::vector<unsigned short> m_nInfluences;
+    //------------------
+    /// @brief bone ids per slot,m_maxInfluences*m_nVerts entries of m_idBytes each
+    //--------------------
+    std::vector<unsigned char> m_boneIds;
+    //------------------
+    /// @brief bone weights per slot,m_maxInfluences*m_nVerts entries of m_weightBytes each
+    //--------------------
+    std::vector<unsigned char> m_weights;
+
+    //-----------------------------------------------
+    /// @brief accessor for the number of bones influencing a vertex
+    ///@param[in] _vert vertex index
+    //---------------------------------------------------
+    inline unsigned int count(unsigned int _vert) const { return m_nInfluences[_vert];}
+    //-----------------------------------------------
+    /// @brief accessor for the bone id stored in a slot
+    ///@param[in] _vert vertex index
+    ///@param[in] _slot influence slot
+    //---------------------------------------------------
+    inline unsigned int boneId(unsigned int _vert,unsigned int _slot) const { return boneIdAt(_slot*m_nVerts+_vert);}
+    //-----------------------------------------------
+    /// @brief accessor for the bone weight stored in a slot
+    ///@param[in] _vert vertex index
+    ///@param[in] _slot influence slot
+    //---------------------------------------------------
+    inline ngl::Real weight(unsigned int _vert,unsigned int _slot) const { return weightAt(_slot*m_nVerts+_vert);}
+    //-----------------------------------------------
+    /// @brief bone id by its index in the table
+    ///@param[in] _index slot*m_nVerts+vertex
+    //---------------------------------------------------
+    inline unsigned int boneIdAt(unsigned int _index) const
+    {
+        const unsigned char *data=&m_boneIds[_index*m_idBytes];
+        switch(m_idBytes)
+        {
+            case 1 : return data[0];
+            case 2 : return *(const unsigned short *)data;
+            default : return *(const unsigned int *)data;
+        }
+    }
+    //-----------------------------------------------
+    /// @brief weight by its index in the table
+    ///@param[in] _index slot*m_nVerts+vertex
+    //---------------------------------------------------
+    inline ngl::Real weightAt(unsigned int _index) const
+    {
+        const unsigned char *data=&m_weights[_index*m_weightBytes];
+        switch(m_weightBytes)
+        {
+            case 1 : return data[0]*(1.0f/255.0f);
+            case 2 : return *(const unsigned short *)data*(1.0f/65535.0f);
+            default : return *(const float *)data;
+        }
+    }
+    //-----------------------------------------------
+    /// @brief raw pointers to the stored ids and weights,for the SIMD kernels
+    ///@param[in] _index slot*m_nVerts+vertex
+    //---------------------------------------------------
+    inline const unsigned char *idData(unsigned int _index) const { return &m_boneIds[_index*m_idBytes];}
+    inline const unsigned char *weightData(unsigned int _index) const { return &m_weights[_index*m_weightBytes];}
+    //-----------------------------------------------
+    /// @brief bytes used by the ids and weights
+    //---------------------------------------------------
+    inline size_t memorySize() const { return m_boneIds.size()+m_weights.size()+m_nInfluences.size()*sizeof(unsigned short);}
 
+    //-----------------------------------------------
+    /// @brief pack the per vertex influence lists into the table
+    ///@param[in] _data per vertex bone ids and weights
+    ///@param[in] _weightBits 32 to keep float weights,16 or 8 to quantise them.
+    /// quantised weights of a vertex are scaled to add up to exactly 1,
+    /// the rounding error goes to the largest weight
+    //---------------------------------------------------
+    void build(const std::vector<vertexBoneInfo> &_data,unsigned int _weightBits=32)
+    {
+        m_nVerts=_data.size();
+        m_maxInfluences=0;
+        unsigned int maxId=0;
+        for(unsigned int i=0; i<m_nVerts; ++i)
+        {
+            if((unsigned int)_data[i].m_nWeights>m_maxInfluences)
+                m_maxInfluences=_data[i].m_nWeights;
+            for(int j=0; j<_data[i].m_nWeights; ++j)
+            {
+                if((unsigned int)_data[i].m_boneIds[j]>maxId)
+                    maxId=_data[i].m_boneIds[j];
+            }
+        }
+        m_idBytes= maxId<256 ? 1 : (maxId<65536 ? 2 : 4);
+        m_weightBytes= _weightBits==8 ? 1 : (_weightBits==16 ? 2 : 4);
+        const unsigned int fullScale= m_weightBytes==1 ? 255 : 65535;
+        m_nInfluences.assign(m_nVerts,0);
+        m_boneIds.assign(m_maxInfluences*m_nVerts*m_idBytes,0);
+        m_weights.assign(m_maxInfluences*m_nVerts*m_weightBytes,0);
+        std::vector<unsigned int> quantised;
+        for(unsigned int i=0; i<m_nVerts; ++i)
+        {
+            const vertexBoneInfo &info=_data[i];
+            m_nInfluences[i]=info.m_nWeights;
+            for(int j=0; j<info.m_nWeights; ++j)
+            {
+                unsigned int index=j*m_nVerts+i;
+                unsigned int id=info.m_boneIds[j];
+                switch(m_idBytes)
+                {
+                    case 1 : m_boneIds[index]=id; break;
+                    case 2 : ((unsigned short *)&m_boneIds[0])[index]=id; break;
+                    default : ((unsigned int *)&m_boneIds[0])[index]=id; break;
+                }
+                if(m_weightBytes==4)
+                    ((float *)&m_weights[0])[index]=info.m_skinWeights[j];
+            }
+            if(m_weightBytes==4 || info.m_nWeights==0)
+                continue;
+            //round each weight of the normalised vertex and give what is left to the largest
+            ngl::Real total=0;
+            for(int j=0; j<info.m_nWeights; ++j)
+                total+=std::max(info.m_skinWeights[j],0.0f);
+            if(total<=0)
+                continue;
+            quantised.assign(info.m_nWeights,0);
+            int sum=0;
+            int largest=0;
+            for(int j=0; j<info.m_nWeights; ++j)
+            {
+                quantised[j]=(unsigned int)(std::max(info.m_skinWeights[j],0.0f)/total*fullScale+0.5f);
+                sum+=quantised[j];
+                if(info.m_skinWeights[j]>info.m_skinWeights[largest])
+                    largest=j;
+            }
+            quantised[largest]=std::max(0,(int)quantised[largest]+(int)fullScale-sum);
+            for(int j=0; j<info.m_nWeights; ++j)
+            {
+                unsigned int index=j*m_nVerts+i;
+                if(m_weightBytes==1)
+                    m_weights[index]=quantised[j];
+                else
+                    ((unsigned short *)&m_weights[0])[index]=quantised[j];
+            }
+        }
+    }
+};
 
 
 #endif // DATATYPES_H
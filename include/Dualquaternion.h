@@ -258,7 +258,7 @@ public:
   ///@param[in] _r Scalar Number to multiply
   ///@param[out] Scalar Multiplied result
   //---------------------------------------------------
-  DualQuaternion operator*(ngl::Real _r) ;
+  DualQuaternion operator*(ngl::Real _r) const;
 
   //-----------------------------------------------
    /// @brief overloaded *= operator to multiply a scalar to itself
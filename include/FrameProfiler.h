@@ -0,0 +1,169 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameProfiler.h
+/// @brief per frame cpu and gpu timings of the stages of the viewer
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+/// @class FrameProfiler
+/// @brief every stage keeps its last few hundred timings in a ring so the minimum,average
+/// and 99th percentile follow what is on screen.cpu stages are timed with begin/end or a
+/// profileScope,the draw is also timed on the GPU with a small ring of timer queries that
+/// are read a few frames later so the cpu never waits for the result
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include<vector>
+#include<chrono>
+
+#include<ngl/Types.h>
+
+//-----------------------------------------------
+/// @brief the timed stages,PROFILE_FRAME is the time between two frames
+//---------------------------------------------------
+enum ProfileStage
+{
+  PROFILE_FRAME,PROFILE_POSE,PROFILE_SKIN,PROFILE_UPLOAD,PROFILE_DRAW,PROFILE_GPU_DRAW,PROFILE_NUM_STAGES
+};
+
+class FrameProfiler
+{
+public:
+  //-----------------------------------------------
+  /// @brief constructor
+  /// @param[in] _window number of frames the statistics are taken over
+  //---------------------------------------------------
+  FrameProfiler(unsigned int _window=240);
+
+  //-----------------------------------------------
+  /// @brief create the timer queries,needs a current GL context
+  //---------------------------------------------------
+  void initGPU();
+  //-----------------------------------------------
+  /// @brief delete the timer queries,needs the same GL context
+  //---------------------------------------------------
+  void releaseGPU();
+
+  //-----------------------------------------------
+  /// @brief start a frame,records the time since the last one and
+  /// collects any GPU timings that have become available
+  //---------------------------------------------------
+  void beginFrame();
+
+  //-----------------------------------------------
+  /// @brief start timing a cpu stage
+  //---------------------------------------------------
+  void begin(ProfileStage _stage);
+  //-----------------------------------------------
+  /// @brief stop timing a cpu stage and store the sample
+  //---------------------------------------------------
+  void end(ProfileStage _stage);
+
+  //-----------------------------------------------
+  /// @brief start the GPU timer around the draw,skipped if every query is still in flight
+  //---------------------------------------------------
+  void beginGPU();
+  //-----------------------------------------------
+  /// @brief stop the GPU timer
+  //---------------------------------------------------
+  void endGPU();
+
+  //-----------------------------------------------
+  /// @brief store a timing
+  /// @param[in] _stage stage
+  /// @param[in] _ms time in milliseconds
+  //---------------------------------------------------
+  void addSample(ProfileStage _stage, float _ms);
+
+  //-----------------------------------------------
+  /// @brief statistics over the stored samples of a stage,all 0 if there are none
+  /// @param[in] _stage stage
+  /// @param[out] o_min smallest time in ms
+  /// @param[out] o_avg average time in ms
+  /// @param[out] o_p99 99th percentile in ms
+  /// @returns the number of samples
+  //---------------------------------------------------
+  unsigned int stats(ProfileStage _stage, float &o_min, float &o_avg, float &o_p99) const;
+
+  //-----------------------------------------------
+  /// @brief a short name for the stage
+  //---------------------------------------------------
+  static const char *stageName(ProfileStage _stage);
+
+private:
+  typedef std::chrono::steady_clock Clock;
+  //-----------------------------------------------
+  /// @brief read the timer queries that have finished
+  //---------------------------------------------------
+  void collectGPU();
+
+  //-----------------------------------------------
+  /// @brief number of samples kept per stage
+  //---------------------------------------------------
+  unsigned int m_window;
+  //-----------------------------------------------
+  /// @brief ring of samples per stage in ms
+  //---------------------------------------------------
+  std::vector<float> m_samples[PROFILE_NUM_STAGES];
+  //-----------------------------------------------
+  /// @brief where the next sample of each stage goes
+  //---------------------------------------------------
+  unsigned int m_next[PROFILE_NUM_STAGES];
+  //-----------------------------------------------
+  /// @brief number of samples stored per stage,at most m_window
+  //---------------------------------------------------
+  unsigned int m_count[PROFILE_NUM_STAGES];
+  //-----------------------------------------------
+  /// @brief when each cpu stage was started
+  //---------------------------------------------------
+  Clock::time_point m_start[PROFILE_NUM_STAGES];
+  //-----------------------------------------------
+  /// @brief when the last frame started,m_frameStarted is false before the first frame
+  //---------------------------------------------------
+  Clock::time_point m_lastFrame;
+  bool m_frameStarted;
+
+  //-----------------------------------------------
+  /// @brief number of timer queries,enough that a result is ready before the query is reused
+  //---------------------------------------------------
+  static const unsigned int GPU_QUERIES = 4;
+  //-----------------------------------------------
+  /// @brief GL_TIME_ELAPSED queries
+  //---------------------------------------------------
+  GLuint m_queries[GPU_QUERIES];
+  //-----------------------------------------------
+  /// @brief true while a query waits for its result
+  //---------------------------------------------------
+  bool m_queryPending[GPU_QUERIES];
+  //-----------------------------------------------
+  /// @brief the query used by the next beginGPU
+  //---------------------------------------------------
+  unsigned int m_nextQuery;
+  //-----------------------------------------------
+  /// @brief true between beginGPU and endGPU when a query was started
+  //---------------------------------------------------
+  bool m_gpuActive;
+  //-----------------------------------------------
+  /// @brief true once the queries have been created
+  //---------------------------------------------------
+  bool m_gpuReady;
+};
+
+//-----------------------------------------------
+/// @brief times a cpu stage from construction to the end of the scope
+//---------------------------------------------------
+struct profileScope
+{
+  profileScope(FrameProfiler &_profiler, ProfileStage _stage) : m_profiler(_profiler), m_stage(_stage)
+  {
+    m_profiler.begin(m_stage);
+  }
+  ~profileScope()
+  {
+    m_profiler.end(m_stage);
+  }
+  FrameProfiler &m_profiler;
+  ProfileStage m_stage;
+};
+
+#endif // FRAMEPROFILER_H
@@ -24,6 +24,8 @@
 
 #include"SceneLoader.h"
 #include"SkinDeformer.h"
+#include"SkinCrowd.h"
+#include"FrameProfiler.h"
 
 
 class GLWindow : public QGLWidget
@@ -78,7 +80,7 @@ public slots :
 /// @brief set the type skinning algorithm to use
 /// _i skinAlgorithm index
 //----------------------------------------------------------------------------------------------------------------------
-  void setSkinAlgorithm(int _i) { m_deformMesh->setSkinAlgorithm(_i);}
+  void setSkinAlgorithm(int _i) { m_deformMesh->setSkinAlgorithm(_i); m_crowd->setSkinAlgorithm(_i);}
   //----------------------------------------------------------------------------------------------------------------------
 /// @brief to load the object
 /// @param _p path on Harddisk
@@ -153,6 +155,18 @@ private :
 //----------------------------------------------------------------------------------------------------------------------
  SkinDeformer *m_deformMesh;
  //----------------------------------------------------------------------------------------------------------------------
+ /// @brief copies of the loaded mesh sharing its data,drawn instead of m_deformMesh in crowd mode
+//----------------------------------------------------------------------------------------------------------------------
+ SkinCrowd *m_crowd;
+ //----------------------------------------------------------------------------------------------------------------------
+ /// @brief crowd mode ON/OFF,toggled with G
+//----------------------------------------------------------------------------------------------------------------------
+ bool m_crowdMode;
+ //----------------------------------------------------------------------------------------------------------------------
+ /// @brief level of detail by screen size ON/OFF,toggled with L
+//----------------------------------------------------------------------------------------------------------------------
+ bool m_lodEnabled;
+ //----------------------------------------------------------------------------------------------------------------------
  /// @brief transforms to draw the finalBones for debug purposes
 //----------------------------------------------------------------------------------------------------------------------
  std::vector<ngl::Mat4> m_boneTransfroms;
@@ -169,10 +183,23 @@ private :
 //----------------------------------------------------------------------------------------------------------------------
  int m_timerID;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the current frame
+  /// @brief number of frames drawn,used to refresh the debug text every few frames
   //----------------------------------------------------------------------------------------------------------------------
   uint m_frame;
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief clip faded out after C was pressed and the frames left in the fade
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_fadeFromClip;
+  unsigned int m_fadeFrames;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief timings of the pose,skinning,upload and draw of every frame
+  //----------------------------------------------------------------------------------------------------------------------
+  FrameProfiler m_profiler;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the debug text,fps and a line per profiled stage
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<QString> m_hudLines;
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief ngl::Font for display
  //----------------------------------------------------------------------------------------------------------------------
   ngl::Text *m_text;
@@ -233,8 +260,13 @@ private:
   void timerEvent(QTimerEvent *_event);
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief function to load the current transforms to the shaders for display
+  /// @param[in] _offset translation of the model,used to place the crowd instances
+ //----------------------------------------------------------------------------------------------------------------------
+  void loadMatricesToShader(const ngl::Vec3 &_offset=ngl::Vec3(0,0,0));
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rebuild the debug text from the profiler statistics
  //----------------------------------------------------------------------------------------------------------------------
-  void loadMatricesToShader();
+  void updateHUD();
 
 };
 
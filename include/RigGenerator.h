@@ -0,0 +1,119 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RigGenerator.h
+/// @brief procedural skinned meshes and animated skeletons of any size for stress testing
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+/// @class RigGenerator
+/// @brief builds a tube standing on the y axis skinned to a chain of bones one unit long.
+/// every vertex is weighted to the bones closest to it along the chain and every bone
+/// bends and twists with its own phase,so all the bones move on every frame.
+/// the data is in the same form SceneLoader keeps after importing a file,
+/// SceneLoader::loadRig() takes it over
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef RIGGENERATOR_H
+#define RIGGENERATOR_H
+
+#include<vector>
+
+#include<ngl/Mat4.h>
+#include<ngl/AbstractMesh.h>
+
+#include "DataTypes.h"
+#include "AnimClip.h"
+
+//-----------------------------------------------
+/// @brief the size of a generated rig
+//---------------------------------------------------
+struct rigSettings
+{
+    //-----------------------------------------------
+    /// @brief constructor,a small rig
+    //---------------------------------------------------
+    rigSettings()
+    {
+        m_nVerts=10000;
+        m_nBones=32;
+        m_nInfluences=4;
+        m_length=2.0f;
+        m_sampleRate=30.0f;
+    }
+    //------------------
+    /// @brief number of vertices wanted,the tube is rounded down to whole rings
+    //--------------------
+    unsigned int m_nVerts;
+    //------------------
+    /// @brief number of bones in the chain
+    //--------------------
+    unsigned int m_nBones;
+    //------------------
+    /// @brief bones weighted to every vertex
+    //--------------------
+    unsigned int m_nInfluences;
+    //------------------
+    /// @brief length of the animation in seconds
+    //--------------------
+    float m_length;
+    //------------------
+    /// @brief samples per second of the animation clip
+    //--------------------
+    float m_sampleRate;
+};
+
+class RigGenerator
+{
+public:
+    //-----------------------------------------------
+    /// @brief build the mesh,skeleton and clip
+    /// @param[in] _settings size of the rig
+    //---------------------------------------------------
+    RigGenerator(const rigSettings &_settings);
+
+    //-----------------------------------------------
+    /// @brief vertex data of the tube
+    //---------------------------------------------------
+    std::vector<vertData> m_vertData;
+    //-----------------------------------------------
+    /// @brief triangles of the tube
+    //---------------------------------------------------
+    std::vector<ngl::Face> m_faces;
+    //-----------------------------------------------
+    /// @brief bone ids and weights per vertex
+    //---------------------------------------------------
+    std::vector<vertexBoneInfo> m_vertexBoneData;
+    //-----------------------------------------------
+    /// @brief bind pose of every bone
+    //---------------------------------------------------
+    std::vector<boneInfo> m_boneData;
+    //-----------------------------------------------
+    /// @brief node table in depth first order,a root node followed by the bones
+    //---------------------------------------------------
+    std::vector<int> m_nodeParents;
+    std::vector<int> m_nodeBones;
+    std::vector<int> m_nodeTracks;
+    std::vector<ngl::Mat4> m_nodeLocal;
+    //-----------------------------------------------
+    /// @brief one track per bone
+    //---------------------------------------------------
+    AnimClip m_clip;
+    //-----------------------------------------------
+    /// @brief length of the clip in ticks
+    //---------------------------------------------------
+    double m_duration;
+    //-----------------------------------------------
+    /// @brief ticks per second of the clip
+    //---------------------------------------------------
+    double m_ticksPerSecond;
+
+private:
+    //-----------------------------------------------
+    /// @brief build the tube and weight it to the chain
+    //---------------------------------------------------
+    void buildMesh(const rigSettings &_settings);
+    //-----------------------------------------------
+    /// @brief build the bones,the node table and the clip
+    //---------------------------------------------------
+    void buildSkeleton(const rigSettings &_settings);
+};
+
+#endif // RIGGENERATOR_H
@@ -7,8 +7,9 @@
 /// http://nccastaff.bournemouth.ac.uk/jmacey/Code/AssetImportDemos
 /// @date 10/10/10
 /// @brief SceneLoader class
-/// currently the loader has a couple of restrictions
-/// 1.Only one mesh can be loaded at a time
+/// every skinned mesh of a scene,or every mesh if none is skinned,is appended to one vertex
+/// and face list,each mesh keeps a meshRange with its first vertex and face.the meshes share
+/// one skeleton,a bone they use with different offset matrices gets a palette entry per matrix
 //----------------------------------------------------------------------------------------------------------------------
 #ifndef SCENELOADER_H
 #define SCENELOADER_H
@@ -29,10 +30,129 @@
 #include<ngl/Util.h>
 
 #include "DataTypes.h"
+#include "AnimClip.h"
+#include "AssetCache.h"
+#include "RigGenerator.h"
 
 //---------------------------------------------------
-/// @brief Sceneloader Class to load a single mesh and animated bones
-/// the ngl::Abstract mesh class was inherited and assimp used to import mesh
+/// @brief the key index each track of a channel was last sampled at.
+/// playback moves forward a little every frame so the search for the
+/// bracketing keys starts from here instead of from the first key
+ //---------------------------------------------------
+struct keyCursor
+{
+    //-----------------------------------------------
+    /// @brief constructor,start at the first key
+    //---------------------------------------------------
+    keyCursor()
+    {
+        m_position=0;
+        m_rotation=0;
+        m_scaling=0;
+    }
+    //------------------
+    /// @brief last key index of each track
+    //--------------------
+    unsigned int m_position;
+    unsigned int m_rotation;
+    unsigned int m_scaling;
+};
+
+//---------------------------------------------------
+/// @brief one node of the flattened scene hierarchy with its parent,animation channel
+/// and bone index looked up once at load time,so evaluating a pose does not compare any
+/// names or walk the assimp tree
+ //---------------------------------------------------
+struct animNode
+{
+    //------------------
+    /// @brief index of the parent in the node table,-1 for the root
+    //--------------------
+    int m_parent;
+    //------------------
+    /// @brief animation channel driving the node,NULL if the node is not animated
+    //--------------------
+    const aiNodeAnim *m_channel;
+    //------------------
+    /// @brief first entry in m_boneData,-1 if the node is not a bone.the node drives every entry
+    /// chained from it by boneInfo::m_nextBone
+    //--------------------
+    int m_boneId;
+    //------------------
+    /// @brief where the channel was last sampled
+    //--------------------
+    keyCursor m_cursor;
+    //------------------
+    /// @brief track of the node in the baked clip,-1 if the node is not animated
+    //--------------------
+    int m_track;
+    //------------------
+    /// @brief highest level of detail that still evaluates the node,the node is skipped
+    /// by the reduced skeletons above it
+    //--------------------
+    unsigned int m_lastLod;
+};
+
+//---------------------------------------------------
+/// @brief one clip playing in a blend,see SceneLoader::blendTransform()
+ //---------------------------------------------------
+struct clipLayer
+{
+    //-----------------------------------------------
+    /// @brief constructor,the first clip at full weight
+    //---------------------------------------------------
+    clipLayer()
+    {
+        m_clip=0;
+        m_time=0;
+        m_weight=1;
+        m_additive=false;
+    }
+    //------------------
+    /// @brief index of the clip
+    //--------------------
+    unsigned int m_clip;
+    //------------------
+    /// @brief time in seconds,wrapped round the length of the clip
+    //--------------------
+    float m_time;
+    //------------------
+    /// @brief weight of the layer,the weights of the normal layers are scaled to add up to 1
+    //--------------------
+    float m_weight;
+    //------------------
+    /// @brief an additive layer adds the change from the first frame of its clip on top
+    /// of the blend of the normal layers instead of being blended with them
+    //--------------------
+    bool m_additive;
+};
+
+//---------------------------------------------------
+/// @brief where one mesh of the file sits in the combined vertex and face lists
+ //---------------------------------------------------
+struct meshRange
+{
+    //------------------
+    /// @brief index of the mesh in the assimp scene
+    //--------------------
+    unsigned int m_sourceMesh;
+    //------------------
+    /// @brief first vertex and number of vertices
+    //--------------------
+    unsigned int m_firstVert;
+    unsigned int m_nVerts;
+    //------------------
+    /// @brief first face and number of faces
+    //--------------------
+    unsigned int m_firstFace;
+    unsigned int m_nFaces;
+};
+
+//---------------------------------------------------
+/// @brief Sceneloader Class to load a skinned mesh and animated bones
+/// the ngl::Abstract mesh class was inherited and assimp used to import mesh.
+/// every skinned mesh of the file is appended to one vertex and face list sharing one
+/// bone table,so a character split into several meshes is posed once and skinned in one pass
  //---------------------------------------------------
 class SceneLoader:public ngl::AbstractMesh
 {
@@ -40,7 +160,7 @@ public:
     //---------------------------------------------------
     /// @brief constructor
      //---------------------------------------------------
-    SceneLoader():AbstractMesh()  {; }
+    SceneLoader():AbstractMesh(),m_duration(0),m_ticksPerSecond(0),m_currentClip(0),m_bakeRate(0),m_maxInfluences(0),m_weightBits(32),m_reorderVertices(false),m_lodLevels(0),m_boundRadius(0),m_useClip(false),m_useCache(true),m_cacheValid(false)  {; }
     //---------------------------------------------------
     /// @brief virtual function inherited from Abstractmesh and defined
     /// here using assimp
@@ -49,10 +169,134 @@ public:
      //---------------------------------------------------
     virtual bool load(const std::string &_fname,bool _calcBB=true);
     //---------------------------------------------------
+    /// @brief fill the mesh,skeleton and clip with a generated rig instead of a file,
+    /// the max influence setting is applied as for a file
+    /// @param[in] _settings size of the rig
+     //---------------------------------------------------
+    void loadRig(const rigSettings &_settings);
+    //---------------------------------------------------
+    /// @brief resample the animation into a compact clip when the file is loaded,
+    /// the assimp keys are then no longer used to evaluate the skeleton.
+    /// set before load(),0 (the default) keeps sampling the assimp keys
+    /// @param[in] _samplesPerSecond bake rate
+     //---------------------------------------------------
+    inline void setBakeRate(float _samplesPerSecond) { m_bakeRate = _samplesPerSecond;}
+    //---------------------------------------------------
+    /// @brief keep only the largest weights of each vertex and renormalise them,
+    /// set before load(),0 (the default) keeps every influence
+    /// @param[in] _max bones per vertex
+     //---------------------------------------------------
+    inline void setMaxInfluences(unsigned int _max) { m_maxInfluences = _max;}
+    //---------------------------------------------------
+    /// @brief store the skin weights as 16 or 8 bit fractions instead of floats,
+    /// set before load(),32 (the default) keeps the float weights
+    /// @param[in] _bits 32,16 or 8
+     //---------------------------------------------------
+    inline void setWeightBits(unsigned int _bits) { m_weightBits = _bits;}
+    //---------------------------------------------------
+    /// @brief sort the vertices by the bones that influence them,dominant bone first,so the
+    /// deformers read the same few bone transforms for runs of vertices.the faces are remapped.
+    /// set before load(),off by default so the vertices keep the order of the file
+    /// @param[in] _reorder true to sort
+     //---------------------------------------------------
+    inline void setReorderVertices(bool _reorder) { m_reorderVertices = _reorder;}
+    //---------------------------------------------------
+    /// @brief build reduced skeletons for meshes that are small on screen,each level merges the
+    /// leaf bones of the level before into their parents and moves their weights there.
+    /// set before load(),0 (the default) builds none
+    /// @param[in] _levels number of reduced levels
+     //---------------------------------------------------
+    inline void setLodLevels(unsigned int _levels) { m_lodLevels = _levels;}
+    //---------------------------------------------------
+    /// @brief number of levels of detail,the full skeleton plus the reduced ones that were built.
+    /// a level stops being built once only root bones are left
+     //---------------------------------------------------
+    inline unsigned int numLods() const { return m_lodInfluences.size() + 1;}
+    //---------------------------------------------------
+    /// @brief the influences to skin with at a level of detail,level 0 is m_influences
+    /// @param[in] _lod level of detail,clamped to the levels built
+     //---------------------------------------------------
+    const skinInfluences &getInfluences(unsigned int _lod) const;
+    //---------------------------------------------------
+    /// @brief number of bones still evaluated at a level of detail
+    /// @param[in] _lod level of detail,clamped to the levels built
+     //---------------------------------------------------
+    unsigned int numLodBones(unsigned int _lod) const;
+    //---------------------------------------------------
+    /// @brief fraction of the screen height covered by the bounds of the bind pose
+    /// @param[in] _modelView model and view matrix the mesh is drawn with,without scale
+    /// @param[in] _offset translation applied to the mesh before _modelView
+    /// @param[in] _fovY vertical field of view of the camera in degrees
+     //---------------------------------------------------
+    float screenSize(const ngl::Mat4 &_modelView, const ngl::Vec3 &_offset, float _fovY) const;
+    //---------------------------------------------------
+    /// @brief pick the level of detail and the frames between skeleton updates for a mesh
+    /// @param[in] _screenSize fraction of the screen height the mesh covers,see screenSize()
+    /// @param[out] o_lod level of detail,below numLods()
+    /// @param[out] o_interval frames between updates,1 to update every frame
+     //---------------------------------------------------
+    void selectLod(float _screenSize, unsigned int &o_lod, unsigned int &o_interval) const;
+    //---------------------------------------------------
+    /// @brief keep a binary copy of the imported data next to the file and load that instead of
+    /// running assimp when the file has not changed,on by default.the cache holds the baked clip
+    /// so it is only used with a bake rate set.m_vertexBoneData is not cached,m_influences is
+    /// each combination of bake rate,influence limit,weight bits and vertex order has its own file
+    /// @param[in] _use true to read and write the cache
+     //---------------------------------------------------
+    inline void setUseCache(bool _use) { m_useCache = _use;}
+    //---------------------------------------------------
+    /// @brief true if the last load() read the cache or wrote a new one
+     //---------------------------------------------------
+    inline bool hasValidCache() const { return m_cacheValid;}
+    //---------------------------------------------------
+    /// @brief number of baked clips,one per animation in the file,0 unless a bake rate was set
+     //---------------------------------------------------
+    inline unsigned int numClips() const { return m_clips.size();}
+    //---------------------------------------------------
+    /// @brief accessor for a baked clip
+    /// @param[in] _clip index of the clip
+     //---------------------------------------------------
+    inline const AnimClip &getClip(unsigned int _clip) const { return m_clips[_clip];}
+    //---------------------------------------------------
+    /// @brief name of a baked clip as stored in the file
+    /// @param[in] _clip index of the clip
+     //---------------------------------------------------
+    inline const std::string &getClipName(unsigned int _clip) const { return m_clipNames[_clip];}
+    //---------------------------------------------------
+    /// @brief length of a baked clip in seconds
+    /// @param[in] _clip index of the clip
+     //---------------------------------------------------
+    double getClipLength(unsigned int _clip) const;
+    //---------------------------------------------------
+    /// @brief index of the clip with a name
+    /// @param[in] _name name of the clip
+    /// @returns the index,-1 if there is no clip with that name
+     //---------------------------------------------------
+    int findClip(const std::string &_name) const;
+    //---------------------------------------------------
+    /// @brief select the clip played by boneTransform(),getDuration() and getTicksPerSec()
+    /// then describe it
+    /// @param[in] _clip index of the clip
+    /// @returns false if there is no such clip
+     //---------------------------------------------------
+    bool setCurrentClip(unsigned int _clip);
+    //---------------------------------------------------
+    /// @brief the clip played by boneTransform()
+     //---------------------------------------------------
+    inline unsigned int getCurrentClip() const { return m_currentClip;}
+    //---------------------------------------------------
+    /// @brief the meshes of the file in the combined vertex and face lists
+     //---------------------------------------------------
+    inline const std::vector<meshRange> &getMeshes() const { return m_meshes;}
+    //---------------------------------------------------
     /// @brief vertex data(UV,Normal,Position) that accessed by skindeformer class
      //---------------------------------------------------
     std::vector <vertData> m_vertData;
     //---------------------------------------------------
+    /// @brief per vertex tangents,empty when the mesh has none
+     //---------------------------------------------------
+    std::vector<ngl::Vec3> m_tangents;
+    //---------------------------------------------------
     /// @brief per bone data(bind pose Matrix,final transform matrix) that accessed by skindeformer class
      //---------------------------------------------------
     std::vector<boneInfo> m_boneData;
@@ -61,6 +305,10 @@ public:
      //---------------------------------------------------
     std::vector<vertexBoneInfo > m_vertexBoneData;
     //---------------------------------------------------
+    /// @brief packed copy of m_vertexBoneData used by the skindeformer every frame
+     //---------------------------------------------------
+    skinInfluences m_influences;
+    //---------------------------------------------------
     /// @brief per vertex endPoint weights
      //---------------------------------------------------
     std::vector<ngl::Real> m_endPointWeights;
@@ -71,24 +319,52 @@ public:
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief accessor for the time in seconds of the animation
     //----------------------------------------------------------------------------------------------------------------------
-    inline double getDuration() const { return m_scene->mAnimations[0]->mDuration;}
+    inline double getDuration() const { return m_duration;}
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief how many tick in the animation per second
     //----------------------------------------------------------------------------------------------------------------------
-    inline double getTicksPerSec() const { return m_scene->mAnimations[0]->mTicksPerSecond;}
+    inline double getTicksPerSec() const { return m_ticksPerSecond;}
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief this set the bone transformation for the current time. This is then passed to the shader
     /// to do the animation of the mesh
     /// @param[in] _timeInSeconds the time to set the animation frame to
     /// @param[out] _transforms an array of transform matrices for the current frame
+    /// @param[in] _lod level of detail,the bones merged at that level keep their last transform
+    //----------------------------------------------------------------------------------------------------------------------
+    void boneTransform(float _timeInSeconds, std::vector<ngl::Mat4>& o_transforms, unsigned int _lod=0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the bone transformation to a weighted blend of baked clips.every clip is sampled
+    /// in the same pass over the skeleton so a blend costs one evaluation,not one per clip.
+    /// additive layers need at least one normal layer with a weight,nodes fall back to their
+    /// rest transform when no normal layer has one
+    /// @param[in] _layers the clips,their times and weights
+    /// @param[out] o_transforms an array of transform matrices for the blended pose
+    /// @param[in] _lod level of detail,the bones merged at that level keep their last transform
+    //----------------------------------------------------------------------------------------------------------------------
+    void blendTransform(const std::vector<clipLayer> &_layers, std::vector<ngl::Mat4> &o_transforms, unsigned int _lod=0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief evaluate one clip into caller owned arrays without touching the loader,so any number of
+    /// threads can pose their own instances of the mesh at once.needs baked clips,without them every
+    /// node keeps its rest transform
+    /// @param[in] _clip index of the baked clip
+    /// @param[in] _timeInSeconds time in the clip,wrapped to its length
+    /// @param[in,out] io_nodeGlobal scratch global transform per node,resized as needed
+    /// @param[out] o_finalTransforms final transform per bone in the order of m_boneData,in the form
+    /// boneTransform() leaves in m_boneData and returns
+    /// @param[in] _lod level of detail,the bones merged at that level are left as they were
     //----------------------------------------------------------------------------------------------------------------------
-    void boneTransform(float _timeInSeconds, std::vector<ngl::Mat4>& o_transforms);
+    void evaluatePose(unsigned int _clip, float _timeInSeconds, std::vector<ngl::Mat4> &io_nodeGlobal,
+                      std::vector<ngl::Mat4> &o_finalTransforms, unsigned int _lod=0) const;
 
     ngl::Face getFace(unsigned int _index)
     {
-        ngl::Face f=getFaceList()[_index];
+        ngl::Face f=m_face[_index];
         return f;
     }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief accessor for the face list without the copy getFaceList() makes
+    //----------------------------------------------------------------------------------------------------------------------
+    inline const std::vector<ngl::Face> &getFaces() const { return m_face;}
 
 private:
     //----------------------------------------------------------------------------------------------------------------------
@@ -108,41 +384,225 @@ private:
      //----------------------------------------------------------------------------------------------------------------------
     Assimp::Importer m_loader;
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief maps a bone name to its index
+    /// @brief maps a bone name to its first entry in m_boneData,the others follow boneInfo::m_nextBone
     //----------------------------------------------------------------------------------------------------------------------
     std::map<std::string,unsigned int> m_boneMapping;
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief every node of the hierarchy in depth first order,so a parent is always before its children
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<animNode> m_nodes;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief local transform of each node from the file,used when the node has no channel
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<ngl::Mat4> m_nodeLocal;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief global transform of each node for the current pose
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<ngl::Mat4> m_nodeGlobal;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief number of bones in the mesh
     //----------------------------------------------------------------------------------------------------------------------
     unsigned int m_numBones;
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief length of the current animation in ticks,copied from the scene so it is known without assimp
+    //----------------------------------------------------------------------------------------------------------------------
+    double m_duration;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ticks per second of the current animation as stored in the file,may be 0
+    //----------------------------------------------------------------------------------------------------------------------
+    double m_ticksPerSecond;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief index of the clip played by boneTransform()
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int m_currentClip;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief samples per second of the baked clip,0 to sample the assimp keys
+    //----------------------------------------------------------------------------------------------------------------------
+    float m_bakeRate;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief most bones kept per vertex,0 for no limit
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int m_maxInfluences;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief bits per stored skin weight,32 16 or 8
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int m_weightBits;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the loaded meshes
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<meshRange> m_meshes;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the entry in m_boneData with each mesh's bind pose of each bone,a row of m_numBones per mesh
+    /// indexed by the first entry of the bone,-1 where the mesh has none.it covers the ancestors of every
+    /// bone a mesh uses so a reduced skeleton moves weights up with the right bind pose,empty for a rig
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<int> m_meshBones;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sort the vertices by influence at load time
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_reorderVertices;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of reduced skeletons to build at load time
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int m_lodLevels;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief influences of each reduced skeleton with the merged bones remapped,level 1 first
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<skinInfluences> m_lodInfluences;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief bones left at each level of detail,level 0 first
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<unsigned int> m_lodBones;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief centre and radius of a sphere round the bind pose,used to measure the screen size
+    //----------------------------------------------------------------------------------------------------------------------
+    ngl::Vec3 m_boundCentre;
+    float m_boundRadius;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief every animation resampled at m_bakeRate,all clips have a track for every node
+    /// animated by any of them so the tracks of a node line up across clips
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<AnimClip> m_clips;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief name and ticks per second of each clip
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<std::string> m_clipNames;
+    std::vector<double> m_clipTicksPerSecond;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true once m_clips has been baked and replaces the assimp keys
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_useClip;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read and write the binary cache of the imported data
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_useCache;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set by load() when the cache on disk matches the file
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_cacheValid;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief calculate the scale value between two keys
+    /// @param[in,out] io_cursor key index the track was last sampled at
     //----------------------------------------------------------------------------------------------------------------------
-    ngl::Vec3 calcInterpolatedScaling(float _animationTime, const aiNodeAnim* _nodeAnim);
+    ngl::Vec3 calcInterpolatedScaling(float _animationTime, const aiNodeAnim* _nodeAnim, unsigned int &io_cursor);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief calculate the rotation value between two keys
+    /// @param[in,out] io_cursor key index the track was last sampled at
     //---------------------------------------------------------------------------------------------------------------------
-    ngl::Quaternion calcInterpolatedRotation(float _animationTime, const aiNodeAnim* _nodeAnim);
+    ngl::Quaternion calcInterpolatedRotation(float _animationTime, const aiNodeAnim* _nodeAnim, unsigned int &io_cursor);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief calculate the position value between two keys
+    /// @param[in,out] io_cursor key index the track was last sampled at
     //----------------------------------------------------------------------------------------------------------------------
-    ngl::Vec3 calcInterpolatedPosition(float _animationTime, const aiNodeAnim* _nodeAnim);
+    ngl::Vec3 calcInterpolatedPosition(float _animationTime, const aiNodeAnim* _nodeAnim, unsigned int &io_cursor);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief find the current node animation
     //----------------------------------------------------------------------------------------------------------------------
     const aiNodeAnim* findNodeAnim(const aiAnimation* _animation, const std::string &_nodeName);
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief recurse the node for the next animation node
+    /// @brief the animated local transform of a node from its channel
+    /// @param[in] _animationTime time in ticks
+    /// @param[in,out] io_node node with a channel,its key cursors are updated
+    //----------------------------------------------------------------------------------------------------------------------
+    ngl::Mat4 calcNodeTransform(float _animationTime, animNode &io_node);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief build a node transform the way assimp stores it from its parts
+    //----------------------------------------------------------------------------------------------------------------------
+    static ngl::Mat4 composeTransform(const ngl::Vec3 &_pos, const ngl::Quaternion &_rot, const ngl::Vec3 &_scale);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sample every animated node of every animation at m_bakeRate into m_clips
+    //----------------------------------------------------------------------------------------------------------------------
+    void bakeClips();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fill the mesh,skeleton and clip from a cache file instead of importing
+    /// @param[in] _fname cache file
+    /// @param[in] _sourceHash hash of the source file
+    /// @returns false if the cache is missing or out of date
+    //----------------------------------------------------------------------------------------------------------------------
+    bool loadCache(const std::string &_fname, uint64_t _sourceHash);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief empty the mesh,skeleton,influences,node table and clips before a load or after a cache that failed part way
+    //----------------------------------------------------------------------------------------------------------------------
+    void clearScene();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the imported mesh,skeleton and clip to a cache file
+    //----------------------------------------------------------------------------------------------------------------------
+    bool saveCache(const std::string &_fname, uint64_t _sourceHash) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the cache file for a source file with the current bake rate,influence limit,weight bits and vertex order
+    /// @param[in] _fname source file
+    //----------------------------------------------------------------------------------------------------------------------
+    std::string cachePath(const std::string &_fname) const;
     //----------------------------------------------------------------------------------------------------------------------
-    void recurseNodeHeirarchy(float _animationTime, const aiNode* _node, const ngl::Mat4& _parentTransform);
+    /// @brief fill the node table from arrays,the nodes are driven by the clip tracks
+    /// @param[in] _parents parent node of each node,-1 for the root
+    /// @param[in] _bones bone of each node,-1 if it is not a bone
+    /// @param[in] _tracks clip track of each node,-1 if it is not animated
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief Load all meshes and store the data
+    void setClipNodes(const std::vector<int> &_parents, const std::vector<int> &_bones, const std::vector<int> &_tracks);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief evaluate the global transform of every node in one pass over the node table
+    /// and set the bone final transforms
+    /// @param[in] _animationTime time in ticks
+    /// @param[in] _lod level of detail,nodes not needed by it are skipped
+    //----------------------------------------------------------------------------------------------------------------------
+    void evaluateHeirarchy(float _animationTime, unsigned int _lod);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief blend the tracks of every node like evaluateHeirarchy() does with one clip
+    /// @param[in] _layers the clips,their times and weights
+    /// @param[in] _lod level of detail,nodes not needed by it are skipped
+    //----------------------------------------------------------------------------------------------------------------------
+    void evaluateBlend(const std::vector<clipLayer> &_layers, unsigned int _lod);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the global transform of a node from its local one and update its bone
+    /// @param[in] _node index in the node table,its parent must already be done
+    /// @param[in] _local transform of the node relative to its parent
+    //----------------------------------------------------------------------------------------------------------------------
+    void setNodeTransform(unsigned int _node, const ngl::Mat4 &_local);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief transpose the final transforms set at a level of detail for NGL and copy out every bone,
+    /// the merged bones were transposed when they were last set so they are copied as they are
+    /// @param[in] _lod level of detail the hierarchy was evaluated at
+    /// @param[out] o_transforms an array of transform matrices
+    //----------------------------------------------------------------------------------------------------------------------
+    void copyFinalTransforms(unsigned int _lod, std::vector<ngl::Mat4> &o_transforms);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a node and its children to m_nodes resolving the channel and bone index
+    /// @param[in] _node assimp node
+    /// @param[in] _parent index of the parent in m_nodes,-1 for the root
+    //----------------------------------------------------------------------------------------------------------------------
+    void buildNodeTable(const aiNode* _node, int _parent);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief append every skinned mesh to the vertex and face lists,every mesh if none is skinned
     //----------------------------------------------------------------------------------------------------------------------
     void loadPrimitives();
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief load bone data and also create a skeleton heriarchy
+    /// @brief load bone data of all the loaded meshes and also create a skeleton heriarchy,
+    /// bones are shared between meshes by name
     //----------------------------------------------------------------------------------------------------------------------
     void loadBones();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the entry of a bone with a bind pose,a new entry is chained on if none of the bone's entries has it
+    /// @param[in] _first first entry of the bone,-1 for a new bone
+    /// @param[in] _bindTransform offset matrix
+    /// @param[in] _parent parent of a new entry
+    /// @returns index in m_boneData
+    //----------------------------------------------------------------------------------------------------------------------
+    int boneEntry(int _first, const ngl::Mat4 &_bindTransform, int _parent);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief limit the influences of every vertex,sort the vertices if asked and pack m_influences
+    //----------------------------------------------------------------------------------------------------------------------
+    void packInfluences();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sort the vertices of each mesh by their bone ids,dominant bone first,and remap the faces.
+    /// vertices with the same bones end up next to each other with the bones in the same slots
+    //----------------------------------------------------------------------------------------------------------------------
+    void reorderVertices();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief measure the bind pose and build the reduced skeletons from m_influences and the node table,
+    /// so it works the same after an import,a cache read or a generated rig
+    //----------------------------------------------------------------------------------------------------------------------
+    void buildLods();
 };
 
 #endif // SCENELOADER_H
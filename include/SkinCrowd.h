@@ -0,0 +1,406 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SkinCrowd.h
+/// @brief many animated copies of one skinned mesh
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+/// @class SkinCrowd
+/// @brief the mesh,influences and clips stay in the SceneLoader and the rest data and index
+/// buffer are built once,so an instance only owns its clip time and bone palette plus the
+/// deformed positions and normals that are sent to the GPU.every pose is evaluated with
+/// SceneLoader::evaluatePose() and all the instances are skinned in one job on the worker
+/// threads,the deformed vertices of every instance go into one stream and one VAO.
+/// with a pose step set the instance times are snapped to it and the palettes are cached by
+/// clip and snapped time,so instances playing the same clip share their pose evaluation and
+/// optionally their skinned vertices.selectLods() gives the instances far from the camera a
+/// reduced skeleton and skins them every few frames,holding their last mesh in between
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef SKINCROWD_H
+#define SKINCROWD_H
+
+#include<vector>
+#include<map>
+#include<stdint.h>
+
+#include<ngl/Vec3.h>
+#include<ngl/VertexArrayObject.h>
+
+#include "SceneLoader.h"
+#include "SkinDeformer.h"
+#include "WorkerPool.h"
+#include "SkinKernels.h"
+
+//-----------------------------------------------
+/// @brief the state of one member of the crowd
+//---------------------------------------------------
+struct crowdInstance
+{
+    //-----------------------------------------------
+    /// @brief constructor,the first clip from the start at normal speed
+    //---------------------------------------------------
+    crowdInstance() : m_clip(0), m_time(0), m_speed(1), m_position(0, 0, 0), m_lod(0), m_updateInterval(1) {}
+    //------------------
+    /// @brief clip played
+    //--------------------
+    unsigned int m_clip;
+    //------------------
+    /// @brief time in the clip in seconds
+    //--------------------
+    float m_time;
+    //------------------
+    /// @brief playback rate,1 is real time
+    //--------------------
+    float m_speed;
+    //------------------
+    /// @brief where the instance is drawn
+    //--------------------
+    ngl::Vec3 m_position;
+    //------------------
+    /// @brief level of detail of the skeleton,see SceneLoader::setLodLevels()
+    //--------------------
+    unsigned int m_lod;
+    //------------------
+    /// @brief frames between skinned poses,1 skins every frame.the instance holds its last pose
+    /// in between,the crowd does not interpolate like SkinDeformer does
+    //--------------------
+    unsigned int m_updateInterval;
+};
+
+class SkinCrowd
+{
+public:
+    //-----------------------------------------------
+    /// @brief default constructor
+    //---------------------------------------------------
+    SkinCrowd();
+
+    //-----------------------------------------------
+    /// @brief destructor,deletes the VAO
+    //---------------------------------------------------
+    ~SkinCrowd();
+
+    //-----------------------------------------------
+    /// @brief share the mesh of a loaded scene,the scene must outlive the crowd.
+    /// the instances are kept
+    /// @param[in] _scene loaded scene with baked clips
+    /// @param[in] _createVAO false to skip the VAO so the crowd runs without a GL context
+    //---------------------------------------------------
+    void setMeshData(const SceneLoader *_scene, bool _createVAO=true);
+
+    //-----------------------------------------------
+    /// @brief change the number of instances,new ones start at the rest pose
+    /// @param[in] _n number of instances
+    //---------------------------------------------------
+    void setNumInstances(unsigned int _n);
+
+    //-----------------------------------------------
+    /// @brief accessor for the number of instances
+    //---------------------------------------------------
+    inline unsigned int numInstances() const { return m_instances.size();}
+
+    //-----------------------------------------------
+    /// @brief accessor for an instance,its clip and time are used by the next update()
+    //---------------------------------------------------
+    inline crowdInstance &getInstance(unsigned int _i) { return m_instances[_i];}
+    inline const crowdInstance &getInstance(unsigned int _i) const { return m_instances[_i];}
+
+    //-----------------------------------------------
+    /// @brief place _n instances on a square grid in the xz plane,each one plays clip i modulo
+    /// the number of clips from a different start time so they do not move in step
+    /// @param[in] _n number of instances
+    /// @param[in] _spacing distance between instances as a multiple of the mesh width
+    //---------------------------------------------------
+    void layoutGrid(unsigned int _n, float _spacing=1.5f);
+
+    //-----------------------------------------------
+    /// @brief move every instance forward in its clip
+    /// @param[in] _seconds time step,scaled by the speed of each instance
+    //---------------------------------------------------
+    void advance(float _seconds);
+
+    //-----------------------------------------------
+    /// @brief pose and skin every instance,this is updatePoses() followed by deform()
+    //---------------------------------------------------
+    void update();
+
+    //-----------------------------------------------
+    /// @brief evaluate the palette of every instance from its clip and time
+    //---------------------------------------------------
+    void updatePoses();
+
+    //-----------------------------------------------
+    /// @brief skin every instance with its palette straight into the draw stream
+    //---------------------------------------------------
+    void deform();
+
+    //-----------------------------------------------
+    /// @brief send the draw stream to the GPU if it changed since the last upload
+    //---------------------------------------------------
+    void upload();
+
+    //-----------------------------------------------
+    /// @brief draw one instance,the caller sets its model matrix first
+    /// @param[in] _i instance
+    //---------------------------------------------------
+    void drawInstance(unsigned int _i);
+
+    //-----------------------------------------------
+    /// @brief snap the instance times to a multiple of _seconds and cache the palettes by clip and
+    /// snapped time,the cache is kept from frame to frame.0 (the default) poses every instance at
+    /// its exact time.changing the step clears the cache
+    /// @param[in] _seconds pose step,eg 1/60 to stay within one frame of the exact pose
+    //---------------------------------------------------
+    void setPoseStep(float _seconds);
+    inline float getPoseStep() const { return m_poseStep;}
+
+    //-----------------------------------------------
+    /// @brief the largest number of cached palettes,the cache is cleared when a frame starts
+    /// with more than this.the default holds a few seconds of every clip at 60 steps a second
+    /// @param[in] _poses number of palettes
+    //---------------------------------------------------
+    inline void setPoseCacheSize(unsigned int _poses) { m_poseCacheSize = _poses;}
+
+    //-----------------------------------------------
+    /// @brief skin each cached pose once and draw every instance with that pose from the same
+    /// vertices,off by default.only used with a pose step.a pose keeps its skinned vertices while
+    /// any instance draws it,so only poses new to the crowd are skinned
+    /// @param[in] _share true to share the skinned vertices
+    //---------------------------------------------------
+    void setShareSkinned(bool _share);
+
+    //-----------------------------------------------
+    /// @brief palettes evaluated by the last updatePoses()
+    //---------------------------------------------------
+    inline unsigned int posesEvaluated() const { return m_posesEvaluated;}
+    //-----------------------------------------------
+    /// @brief meshes skinned by the last deform(),less than the instances when they are shared
+    /// or updated every few frames
+    //---------------------------------------------------
+    inline unsigned int meshesSkinned() const { return m_meshesSkinned;}
+
+    //-----------------------------------------------
+    /// @brief set the level of detail and update interval of every instance from how much of the
+    /// screen it covers,see SceneLoader::selectLod().the instances updated every few frames are
+    /// staggered so each frame skins an even share of them.not used while the skinned vertices
+    /// are shared,every pose is skinned then
+    /// @param[in] _modelView model and view matrix the crowd is drawn with
+    /// @param[in] _fovY vertical field of view of the camera in degrees
+    //---------------------------------------------------
+    void selectLods(const ngl::Mat4 &_modelView, float _fovY);
+
+    //-----------------------------------------------
+    /// @brief put every instance back on the full skeleton,skinned every frame
+    //---------------------------------------------------
+    void resetLods();
+
+    //-----------------------------------------------
+    /// @brief function to set the Skinning algorithm,STRETCH_TWIST has no kernel and uses LINEAR_BLEND
+    ///param[in] _i index in SkinDeformTypes
+    //---------------------------------------------------
+    void setSkinAlgorithm(int _i);
+
+    //-----------------------------------------------
+    /// @brief deform the normals along with the positions,on by default
+    ///param[in] _skin true to deform the normals
+    //---------------------------------------------------
+    void setSkinNormals(bool _skin);
+
+    //-----------------------------------------------
+    /// @brief set the number of threads the instances are skinned on,0 uses all the hardware threads
+    ///param[in] _n number of threads
+    //---------------------------------------------------
+    inline void setNumThreads(unsigned int _n) { m_workers.setNumThreads(_n);}
+    inline unsigned int getNumThreads() const { return m_workers.numThreads();}
+
+    //-----------------------------------------------
+    /// @brief set the instruction set used by the kernels,clamped to what the cpu supports
+    ///param[in] _level SkinKernels::SimdLevel
+    //---------------------------------------------------
+    void setSimdLevel(SkinKernels::SimdLevel _level);
+    inline SkinKernels::SimdLevel getSimdLevel() const { return m_simdLevel;}
+
+    //-----------------------------------------------
+    /// @brief the deformed positions and normals (x,y,z,nx,ny,nz) of one instance
+    //---------------------------------------------------
+    inline const float *getInstanceStream(unsigned int _i) const { return &m_drawStream[(size_t)m_instanceBlocks[_i] * m_nVerts * 6];}
+
+    //-----------------------------------------------
+    /// @brief bytes held once for the whole crowd,the rest data,UVs and indices
+    //---------------------------------------------------
+    size_t sharedBytes() const;
+
+    //-----------------------------------------------
+    /// @brief bytes held per instance,its state,palette and deformed vertices
+    //---------------------------------------------------
+    size_t instanceBytes() const;
+
+private:
+    //-----------------------------------------------
+    /// @brief not copyable,the VAO is owned
+    //---------------------------------------------------
+    SkinCrowd(const SkinCrowd &);
+    SkinCrowd &operator=(const SkinCrowd &);
+
+    //-----------------------------------------------
+    /// @brief create the VAO with one dynamic buffer for every instance,a static UV buffer and
+    /// an element buffer for the faces
+    //---------------------------------------------------
+    void createVAO();
+    //-----------------------------------------------
+    /// @brief delete the VAO
+    //---------------------------------------------------
+    void releaseVAO();
+    //-----------------------------------------------
+    /// @brief set the deformed vertices of blocks [_begin,_end) to the rest pose
+    //---------------------------------------------------
+    void resetBlocks(unsigned int _begin, unsigned int _end);
+    //-----------------------------------------------
+    /// @brief the kernel streams writing into a block of the draw stream
+    //---------------------------------------------------
+    SkinKernels::skinStreams blockStreams(unsigned int _block);
+    //-----------------------------------------------
+    /// @brief floats per palette in m_palettes
+    //---------------------------------------------------
+    inline unsigned int paletteSize() const { return m_nBones * (m_skinAlgorithm == DUAL_QUATERNION ? 8 : 16);}
+    //-----------------------------------------------
+    /// @brief forget every cached palette
+    //---------------------------------------------------
+    void clearPoseCache();
+    //-----------------------------------------------
+    /// @brief the time an instance is posed at,snapped to the pose step when there is one
+    /// @param[in] _instance instance
+    /// @param[out] o_key clip and step index,the cache key
+    //---------------------------------------------------
+    float poseTime(const crowdInstance &_instance, uint64_t &o_key) const;
+    //-----------------------------------------------
+    /// @brief set the palette slot of every instance,adding new poses to the cache
+    /// @param[out] o_missing instances whose slot has no palette yet
+    //---------------------------------------------------
+    void assignPoseSlots(std::vector<unsigned int> &o_missing);
+    //-----------------------------------------------
+    /// @brief true if an instance is skinned this frame,its update interval is staggered by its index
+    /// @param[in] _i instance
+    //---------------------------------------------------
+    bool isDue(unsigned int _i) const;
+    //-----------------------------------------------
+    /// @brief forget which pose each shared block holds so they are all skinned again
+    //---------------------------------------------------
+    void clearSharedBlocks();
+
+    //-----------------------------------------------
+    /// @brief the shared scene
+    //---------------------------------------------------
+    const SceneLoader *m_scene;
+    //-----------------------------------------------
+    /// @brief rest positions and normals as a structure of arrays,shared by every instance
+    //---------------------------------------------------
+    std::vector<ngl::Real> m_restX;
+    std::vector<ngl::Real> m_restY;
+    std::vector<ngl::Real> m_restZ;
+    std::vector<ngl::Real> m_restNX;
+    std::vector<ngl::Real> m_restNY;
+    std::vector<ngl::Real> m_restNZ;
+    //-----------------------------------------------
+    /// @brief UVs and triangle indices,only kept to fill the VAO
+    //---------------------------------------------------
+    std::vector<float> m_uvs;
+    std::vector<GLuint> m_drawIndices;
+    //-----------------------------------------------
+    /// @brief width of the rest mesh in x,used to space the grid
+    //---------------------------------------------------
+    float m_width;
+    //-----------------------------------------------
+    /// @brief vertices and bones of the mesh
+    //---------------------------------------------------
+    unsigned int m_nVerts;
+    unsigned int m_nBones;
+    //-----------------------------------------------
+    /// @brief the state of every instance
+    //---------------------------------------------------
+    std::vector<crowdInstance> m_instances;
+    //-----------------------------------------------
+    /// @brief palettes back to back,16 floats per bone for linear blend and 8 for dual quaternion.
+    /// one per instance without a pose step,otherwise one per cached pose
+    //---------------------------------------------------
+    std::vector<float> m_palettes;
+    //-----------------------------------------------
+    /// @brief the palette and the draw stream block of every instance
+    //---------------------------------------------------
+    std::vector<unsigned int> m_instanceSlots;
+    std::vector<unsigned int> m_instanceBlocks;
+    //-----------------------------------------------
+    /// @brief blocks of m_drawStream in use,each with an instance whose mesh or pose it holds
+    //---------------------------------------------------
+    unsigned int m_nBlocks;
+    std::vector<unsigned int> m_blockInstances;
+    //-----------------------------------------------
+    /// @brief when sharing,the block holding each cache slot and the slot held by each block,-1 for none.
+    /// a block keeps its skinned pose between frames until the slot is no longer drawn
+    //---------------------------------------------------
+    std::vector<int> m_slotBlocks;
+    std::vector<int> m_blockSlots;
+    //-----------------------------------------------
+    /// @brief blocks skinned by the last deform()
+    //---------------------------------------------------
+    unsigned int m_meshesSkinned;
+    //-----------------------------------------------
+    /// @brief calls to deform(),staggers the instances updated every few frames
+    //---------------------------------------------------
+    unsigned int m_frame;
+    //-----------------------------------------------
+    /// @brief skin every instance on the next deform(),set when the blocks no longer
+    /// hold the mesh of their own instance
+    //---------------------------------------------------
+    bool m_skinAll;
+    //-----------------------------------------------
+    /// @brief pose step in seconds,0 when off
+    //---------------------------------------------------
+    float m_poseStep;
+    //-----------------------------------------------
+    /// @brief cache slot of each clip,level of detail and step index,the clip is in the top 24 bits
+    /// and the level of detail in the 8 below
+    //---------------------------------------------------
+    std::map<uint64_t, unsigned int> m_poseCache;
+    unsigned int m_poseCacheSize;
+    //-----------------------------------------------
+    /// @brief draw instances with the same pose from one block
+    //---------------------------------------------------
+    bool m_shareSkinned;
+    //-----------------------------------------------
+    /// @brief palettes evaluated by the last updatePoses()
+    //---------------------------------------------------
+    unsigned int m_posesEvaluated;
+    //-----------------------------------------------
+    /// @brief deformed position and normal of every vertex of every instance,instance i
+    /// starts at i*m_nVerts*6
+    //---------------------------------------------------
+    std::vector<float> m_drawStream;
+    //-----------------------------------------------
+    /// @brief set when m_drawStream has not been uploaded yet
+    //---------------------------------------------------
+    bool m_streamDirty;
+    //-----------------------------------------------
+    /// @brief VAO holding every instance,0 without a GL context
+    //---------------------------------------------------
+    ngl::VertexArrayObject *m_vao;
+    //-----------------------------------------------
+    /// @brief instances the VAO buffer was sized for
+    //---------------------------------------------------
+    unsigned int m_vaoInstances;
+    //-----------------------------------------------
+    /// @brief false when setMeshData() was told there is no GL context
+    //---------------------------------------------------
+    bool m_createVAO;
+    //-----------------------------------------------
+    /// @brief skinning algorithm and options
+    //---------------------------------------------------
+    SkinDeformTypes m_skinAlgorithm;
+    bool m_skinNormals;
+    SkinKernels::SimdLevel m_simdLevel;
+    //-----------------------------------------------
+    /// @brief worker threads the poses and vertices are split across
+    //---------------------------------------------------
+    WorkerPool m_workers;
+};
+
+#endif // SKINCROWD_H
@@ -22,6 +22,9 @@
 
 #include "SceneLoader.h"
 #include "DataTypes.h"
+#include "Dualquaternion.h"
+#include "WorkerPool.h"
+#include "SkinKernels.h"
 
 //-----------------------------------------------
 /// @brief enum desribing the different skin Algorithms
@@ -52,15 +55,39 @@ public:
     //-----------------------------------------------
     /// @brief update the defomed mesh based on the update scene data
     /// calls the corresponding skin deformer based on the set algorithm
+    /// this is deform() followed by prepareDraw()
     //---------------------------------------------------
     void update();
 
+    //-----------------------------------------------
+    /// @brief deform the mesh with the selected algorithm without touching the draw data,
+    /// with an update interval set the calls in between interpolate the last two poses
+    //---------------------------------------------------
+    void deform();
+
+    //-----------------------------------------------
+    /// @brief copy the deformed mesh into the draw stream,it is sent to the GPU on the next draw
+    //---------------------------------------------------
+    void prepareDraw();
+
+    //-----------------------------------------------
+    /// @brief send the draw stream to the GPU if it changed since the last upload,
+    /// drawDeformMesh() calls it so this is only needed to time the upload on its own
+    //---------------------------------------------------
+    void upload();
+
     //-----------------------------------------------
     /// @brief this sets a pointer to the scene data and also creates a
     /// copy of the vertex data
     /// @param[is] SceneLoader sceneData
+    /// @param[in] _createVAO false to skip the VAO so the deformer runs without a GL context
     //---------------------------------------------------
-    void setMeshData(SceneLoader *_scene);
+    void setMeshData(SceneLoader *_scene, bool _createVAO=true);
+
+    //-----------------------------------------------
+    /// @brief accessor for the deformed vertices
+    //---------------------------------------------------
+    inline const std::vector<vertData> &getDeformMesh() const { return m_deformMesh;}
 
     //-----------------------------------------------
     /// @brief function to set the Skinning algorithm
@@ -68,6 +95,87 @@ public:
     //---------------------------------------------------
     void setSkinAlgorithm(int _i);
 
+    //-----------------------------------------------
+    /// @brief set the number of threads used to deform the mesh
+    /// the vertices are split into one block per thread,1 runs the serial path
+    /// and 0 uses all the hardware threads.the result is the same for any count
+    ///param[in] _n number of threads
+    //---------------------------------------------------
+    void setNumThreads(unsigned int _n);
+
+    //-----------------------------------------------
+    /// @brief accessor for the number of threads the vertices are split across
+    //---------------------------------------------------
+    inline unsigned int getNumThreads() const { return m_workers.numThreads();}
+
+    //-----------------------------------------------
+    /// @brief set the instruction set used by the vectorised kernels
+    /// it is clamped to what the cpu supports,by default the best one is used
+    ///param[in] _level SkinKernels::SimdLevel
+    //---------------------------------------------------
+    void setSimdLevel(SkinKernels::SimdLevel _level);
+
+    //-----------------------------------------------
+    /// @brief accessor for the instruction set in use
+    //---------------------------------------------------
+    inline SkinKernels::SimdLevel getSimdLevel() const { return m_simdLevel;}
+
+    //-----------------------------------------------
+    /// @brief deform the current pose with both the original ngl path and the vectorised
+    /// kernel of the selected algorithm and return the largest position or normal difference between them,
+    /// normals are only compared while they are skinned.STRETCH_TWIST has no kernel and returns 0
+    //---------------------------------------------------
+    ngl::Real checkKernel();
+
+    //-----------------------------------------------
+    /// @brief deform the normals in the same pass as the positions,on by default.
+    /// when off the normals are left at the bind pose
+    ///param[in] _skin true to deform the normals
+    //---------------------------------------------------
+    void setSkinNormals(bool _skin);
+
+    //-----------------------------------------------
+    /// @brief also deform the tangents,off by default.
+    /// only used when the imported mesh has tangents
+    ///param[in] _skin true to deform the tangents
+    //---------------------------------------------------
+    void setSkinTangents(bool _skin);
+
+    //-----------------------------------------------
+    /// @brief accessor for the deformed tangents,empty unless setSkinTangents is on
+    //---------------------------------------------------
+    inline const std::vector<ngl::Vec3> &getDeformTangents() const { return m_deformTangents;}
+
+    //-----------------------------------------------
+    /// @brief skin with the influences of a reduced skeleton,see SceneLoader::setLodLevels()
+    ///param[in] _lod level of detail,0 for the full skeleton
+    //---------------------------------------------------
+    void setLod(unsigned int _lod);
+
+    //-----------------------------------------------
+    /// @brief accessor for the level of detail skinned with
+    //---------------------------------------------------
+    inline unsigned int getLod() const { return m_lod;}
+
+    //-----------------------------------------------
+    /// @brief skin only every few calls to deform() and interpolate the last two skinned
+    /// poses in between,so the mesh runs that many frames behind the skeleton.the tangents
+    /// are held at the last skinned pose.1 (the default) skins every call
+    ///param[in] _frames calls to deform() per skinned pose
+    //---------------------------------------------------
+    void setUpdateInterval(unsigned int _frames);
+
+    //-----------------------------------------------
+    /// @brief accessor for the calls to deform() per skinned pose
+    //---------------------------------------------------
+    inline unsigned int getUpdateInterval() const { return m_updateInterval;}
+
+    //-----------------------------------------------
+    /// @brief true if the next deform() skins the bone transforms,when false it only
+    /// interpolates and the skeleton does not need to be evaluated for this frame
+    //---------------------------------------------------
+    bool needsPose() const;
+
 private:
     //-----------------------------------------------
     /// @brief vertex data that is used to draw the deformed mesh
@@ -78,6 +186,36 @@ private:
     //---------------------------------------------------
     std::vector<vertData> m_origMesh;
     //-----------------------------------------------
+    /// @brief rest positions as a structure of arrays for the vectorised kernels
+    //---------------------------------------------------
+    std::vector<ngl::Real> m_restX;
+    std::vector<ngl::Real> m_restY;
+    std::vector<ngl::Real> m_restZ;
+    //-----------------------------------------------
+    /// @brief rest normals as a structure of arrays for the vectorised kernels
+    //---------------------------------------------------
+    std::vector<ngl::Real> m_restNX;
+    std::vector<ngl::Real> m_restNY;
+    std::vector<ngl::Real> m_restNZ;
+    //-----------------------------------------------
+    /// @brief rest tangents as a structure of arrays,empty if the mesh has none
+    //---------------------------------------------------
+    std::vector<ngl::Real> m_restTX;
+    std::vector<ngl::Real> m_restTY;
+    std::vector<ngl::Real> m_restTZ;
+    //-----------------------------------------------
+    /// @brief deformed tangents,sized only while tangents are skinned
+    //---------------------------------------------------
+    std::vector<ngl::Vec3> m_deformTangents;
+    //-----------------------------------------------
+    /// @brief deform the normals along with the positions
+    //---------------------------------------------------
+    bool m_skinNormals;
+    //-----------------------------------------------
+    /// @brief deform the tangents along with the positions
+    //---------------------------------------------------
+    bool m_skinTangents;
+    //-----------------------------------------------
     /// @brief total number of vertices
     //---------------------------------------------------
     unsigned int m_nVerts;
@@ -86,6 +224,20 @@ private:
     //---------------------------------------------------
     ngl::VertexArrayObject *m_deformMeshVAO;
     //-----------------------------------------------
+    /// @brief triangle indices into the mesh vertices,built once from the face list
+    /// and kept in the VAO element buffer
+    //---------------------------------------------------
+    std::vector<GLuint> m_drawIndices;
+    //-----------------------------------------------
+    /// @brief deformed position and normal (x,y,z,nx,ny,nz) per unique mesh vertex,
+    /// the only data sent to the GPU every frame
+    //---------------------------------------------------
+    std::vector<float> m_drawStream;
+    //-----------------------------------------------
+    /// @brief set by update() when m_drawStream has not been uploaded yet
+    //---------------------------------------------------
+    bool m_streamDirty;
+    //-----------------------------------------------
     /// @brief Boolean variable to check if the deformed is initilazed
     //---------------------------------------------------
     bool m_meshSet;
@@ -97,23 +249,128 @@ private:
     /// @brief enum to select the skinAlgorithm
     //---------------------------------------------------
     SkinDeformTypes m_skinAlgorithm;
+    //-----------------------------------------------
+    /// @brief unit DualQuaternion per bone for the current frame
+    /// built once per update from the bone final transforms
+    //---------------------------------------------------
+    std::vector<DualQuaternion> m_dqPalette;
+    //-----------------------------------------------
+    /// @brief m_dqPalette as 8 floats per bone for the dual quaternion kernel
+    //---------------------------------------------------
+    std::vector<float> m_dqPackedPalette;
+    //-----------------------------------------------
+    /// @brief persistent worker threads the vertex loop is split across
+    //---------------------------------------------------
+    WorkerPool m_workers;
+    //-----------------------------------------------
+    /// @brief bone final transforms as 16 floats per bone for the linear blend kernel
+    //---------------------------------------------------
+    std::vector<float> m_matrixPalette;
+    //-----------------------------------------------
+    /// @brief instruction set used by the kernels
+    //---------------------------------------------------
+    SkinKernels::SimdLevel m_simdLevel;
+    //-----------------------------------------------
+    /// @brief level of detail of the influences
+    //---------------------------------------------------
+    unsigned int m_lod;
+    //-----------------------------------------------
+    /// @brief calls to deform() per skinned pose
+    //---------------------------------------------------
+    unsigned int m_updateInterval;
+    //-----------------------------------------------
+    /// @brief calls to deform() since the last skinned pose
+    //---------------------------------------------------
+    unsigned int m_keyAge;
+    //-----------------------------------------------
+    /// @brief the last two skinned poses as (x,y,z,nx,ny,nz) per vertex,the mesh
+    /// is interpolated from the first to the second until the next pose is skinned
+    //---------------------------------------------------
+    std::vector<float> m_keyFrom;
+    std::vector<float> m_keyTo;
+    //-----------------------------------------------
+    /// @brief false until m_keyTo holds a pose
+    //---------------------------------------------------
+    bool m_keysValid;
 
+    //-----------------------------------------------
+    /// @brief the influences of the selected level of detail
+    //---------------------------------------------------
+    const skinInfluences &lodInfluences() const;
+    //-----------------------------------------------
+    /// @brief deform every vertex with the selected algorithm
+    //---------------------------------------------------
+    void skin();
+    //-----------------------------------------------
+    /// @brief keep the mesh just skinned as the newest key
+    ///param[in] _begin first vertex to copy
+    ///param[in] _end one past the last vertex to copy
+    //---------------------------------------------------
+    void storeKey(unsigned int _begin, unsigned int _end);
+    //-----------------------------------------------
+    /// @brief set the deformed mesh part of the way between the two keys
+    ///param[in] _t 0 for the older key,1 for the newer one
+    ///param[in] _begin first vertex to set
+    ///param[in] _end one past the last vertex to set
+    //---------------------------------------------------
+    void interpolateKeys(float _t, unsigned int _begin, unsigned int _end);
+    //-----------------------------------------------
+    /// @brief the rest data and output pointers passed to the kernels
+    /// for the current normal and tangent settings
+    //---------------------------------------------------
+    SkinKernels::skinStreams kernelStreams();
     //-----------------------------------------------
     /// @brief deform and set the deformed vertices using linear blend algorithm
+    ///param[in] _begin first vertex to deform
+    ///param[in] _end one past the last vertex to deform
+    //---------------------------------------------------
+    void deformMesh_LSB(unsigned int _begin, unsigned int _end);
+    //-----------------------------------------------
+    /// @brief the original ngl::Mat4 linear blend deformer,kept as the reference for the kernels
+    ///param[in] _begin first vertex to deform
+    ///param[in] _end one past the last vertex to deform
+    //---------------------------------------------------
+    void deformMesh_LSBReference(unsigned int _begin, unsigned int _end);
+    //-----------------------------------------------
+    /// @brief convert every bone final transform to a DualQuaternion
+    /// so the Dual Quaternion deformer does not convert them per influence
     //---------------------------------------------------
-    void deformMesh_LSB();
+    void buildDQPalette();
     //-----------------------------------------------
     /// @brief deform and set the deformed vertices using Dual Quaternion algorithm
+    ///param[in] _begin first vertex to deform
+    ///param[in] _end one past the last vertex to deform
     //---------------------------------------------------
-    void deformMesh_DQ();
+    void deformMesh_DQ(unsigned int _begin, unsigned int _end);
+    //-----------------------------------------------
+    /// @brief the original DualQuaternion deformer that goes through toMatrix(),
+    /// kept as the reference for the kernels
+    ///param[in] _begin first vertex to deform
+    ///param[in] _end one past the last vertex to deform
+    //---------------------------------------------------
+    void deformMesh_DQReference(unsigned int _begin, unsigned int _end);
     //-----------------------------------------------
     /// @brief deform and set the deformed vertices using Stretch and twistable algorithm
+    ///param[in] _begin first vertex to deform
+    ///param[in] _end one past the last vertex to deform
     //---------------------------------------------------
-    void deformMesh_STBS();
+    void deformMesh_STBS(unsigned int _begin, unsigned int _end);
+     //-----------------------------------------------
+     /// @brief create the VAO once with a dynamic position/normal buffer that is refilled
+     /// every frame,a static UV buffer and an element buffer for the faces
+     ///param[in] _createVAO false to only build the index list and draw stream
+     //---------------------------------------------------
+     void setDeformMeshVAO(bool _createVAO);
+     //-----------------------------------------------
+     /// @brief copy the deformed positions and normals into the draw stream
+     ///param[in] _begin first vertex to copy
+     ///param[in] _end one past the last vertex to copy
+     //---------------------------------------------------
+     void packDrawStream(unsigned int _begin, unsigned int _end);
      //-----------------------------------------------
-     /// @brief set the VAO from the deformed vertex data for OpenGL
+     /// @brief orphan the dynamic buffer and upload the draw stream into it
      //---------------------------------------------------
-     void setDeformMeshVAO();
+     void uploadDrawStream();
 };
 
 #endif // SKINDEFORMER_H
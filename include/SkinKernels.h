@@ -0,0 +1,173 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SkinKernels.h
+/// @brief vectorised inner loops for the skin deformers
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+/// the kernels work on a range of vertices and read the rest data as a structure of arrays
+/// (one array for x,y and z) so 4 (SSE) or 8 (AVX2) vertices are deformed per iteration.
+/// the instruction set is picked at runtime,machines without SSE2/AVX2 or compilers without
+/// the intrinsics use the scalar version which does the same arithmetic one vertex at a time
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef SKINKERNELS_H
+#define SKINKERNELS_H
+
+#include<vector>
+
+#include "DataTypes.h"
+#include "Dualquaternion.h"
+
+namespace SkinKernels
+{
+
+//-----------------------------------------------
+/// @brief instruction sets the kernels are written for,in increasing order
+//---------------------------------------------------
+enum SimdLevel
+{
+  SIMD_SCALAR,SIMD_SSE2,SIMD_AVX2
+};
+
+//-----------------------------------------------
+/// @brief the best instruction set supported by both the build and the cpu
+///@param[out] SimdLevel
+//---------------------------------------------------
+extern SimdLevel detectSimdLevel();
+
+//-----------------------------------------------
+/// @brief name of an instruction set for display
+///@param[in] _level instruction set
+//---------------------------------------------------
+extern const char *simdLevelName(SimdLevel _level);
+
+//-----------------------------------------------
+/// @brief copy the bone final transforms into a flat array of 16 floats per bone
+/// in ngl::Mat4 memory order (m_00,m_01...m_33) so the kernels can load them directly
+///@param[in] _bones bone data with the current final transforms
+///@param[out] o_palette flat matrix array,resized to 16 floats per bone
+//---------------------------------------------------
+extern void packMatrixPalette(const std::vector<boneInfo> &_bones, std::vector<float> &o_palette);
+
+//-----------------------------------------------
+/// @brief copy bone final transforms held outside the bone data,such as a pose from
+/// SceneLoader::evaluatePose(),into 16 floats per bone like the version above
+///@param[in] _transforms final transform per bone
+///@param[out] o_palette 16 floats per bone
+//---------------------------------------------------
+extern void packMatrixPalette(const std::vector<ngl::Mat4> &_transforms, float *o_palette);
+
+//-----------------------------------------------
+/// @brief the per vertex inputs and outputs of a kernel
+/// rest data is a structure of arrays (one array per component) indexed by vertex,
+/// output vertex i is written to o_x[i*stride+0,1,2].
+/// normals and tangents are optional,leave the pointers at 0 to skip them
+//---------------------------------------------------
+struct skinStreams
+{
+  //-----------------------------------------------
+  /// @brief constructor,every stream is off
+  //---------------------------------------------------
+  skinStreams()
+  {
+    m_restX=m_restY=m_restZ=0;
+    m_restNX=m_restNY=m_restNZ=0;
+    m_restTX=m_restTY=m_restTZ=0;
+    o_pos=o_normal=o_tangent=0;
+    m_posStride=m_normalStride=m_tangentStride=3;
+  }
+  //------------------
+  /// @brief rest positions
+  //--------------------
+  const float *m_restX;
+  const float *m_restY;
+  const float *m_restZ;
+  //------------------
+  /// @brief rest normals
+  //--------------------
+  const float *m_restNX;
+  const float *m_restNY;
+  const float *m_restNZ;
+  //------------------
+  /// @brief rest tangents
+  //--------------------
+  const float *m_restTX;
+  const float *m_restTY;
+  const float *m_restTZ;
+  //------------------
+  /// @brief deformed positions,normals and tangents
+  //--------------------
+  float *o_pos;
+  float *o_normal;
+  float *o_tangent;
+  //------------------
+  /// @brief distance in floats between two output vertices of each stream
+  //--------------------
+  unsigned int m_posStride;
+  unsigned int m_normalStride;
+  unsigned int m_tangentStride;
+};
+
+//-----------------------------------------------
+/// @brief linear blend skinning of a range of vertices
+/// the weighted sum of the bone matrices is applied to the rest position the same way
+/// multMatrix() in Util.h does,including the divide by w when w is greater than 1.
+/// normals use the cofactor (inverse transpose up to scale) of the blended 3x3 and
+/// tangents the blended 3x3 itself,both are renormalised
+///@param[in] _level instruction set to use,must not be above detectSimdLevel()
+///@param[in] _influences packed bone ids and weights
+///@param[in] _palette flat matrices from packMatrixPalette
+///@param[in,out] _streams rest data and where to write the result
+///@param[in] _begin first vertex to deform
+///@param[in] _end one past the last vertex to deform
+//---------------------------------------------------
+extern void skinLBS(
+                     SimdLevel _level,
+                     const skinInfluences &_influences,
+                     const float *_palette,
+                     const skinStreams &_streams,
+                     unsigned int _begin,
+                     unsigned int _end
+                   );
+
+//-----------------------------------------------
+/// @brief copy unit DualQuaternions into a flat array of 8 floats per bone
+/// laid out as real x,y,z,w followed by dual x,y,z,w
+///@param[in] _dq one DualQuaternion per bone
+///@param[out] o_palette flat array,resized to 8 floats per bone
+//---------------------------------------------------
+extern void packDualQuatPalette(const std::vector<DualQuaternion> &_dq, std::vector<float> &o_palette);
+
+//-----------------------------------------------
+/// @brief convert bone final transforms to unit DualQuaternions and pack them in the
+/// packDualQuatPalette() layout
+///@param[in] _transforms final transform per bone
+///@param[out] o_palette 8 floats per bone
+//---------------------------------------------------
+extern void packDualQuatPalette(const std::vector<ngl::Mat4> &_transforms, float *o_palette);
+
+//-----------------------------------------------
+/// @brief dual quaternion skinning of a range of vertices
+/// the bone DualQuaternions are blended with the antipodality check against the first bone,
+/// scaled by the inverse magnitude of the real part and applied to the rest position directly
+/// (rotation by the real part plus the translation 2*dual*realConjugate) without building a matrix.
+/// normals and tangents are rotated by the real part only.
+/// vertices without any influence keep their rest data
+///@param[in] _level instruction set to use,must not be above detectSimdLevel()
+///@param[in] _influences packed bone ids and weights
+///@param[in] _palette flat DualQuaternions from packDualQuatPalette
+///@param[in,out] _streams rest data and where to write the result
+///@param[in] _begin first vertex to deform
+///@param[in] _end one past the last vertex to deform
+//---------------------------------------------------
+extern void skinDQ(
+                    SimdLevel _level,
+                    const skinInfluences &_influences,
+                    const float *_palette,
+                    const skinStreams &_streams,
+                    unsigned int _begin,
+                    unsigned int _end
+                  );
+
+}
+
+#endif // SKINKERNELS_H
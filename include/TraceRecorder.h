@@ -0,0 +1,145 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TraceRecorder.h
+/// @brief records timing spans from any thread into a ring buffer that can be saved as a chrome trace
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+/// @class TraceRecorder
+/// @brief a singleton holding the last few minutes of spans.a span takes a slot with one atomic
+/// increment so the worker threads never wait on each other,and when the ring is full the oldest
+/// spans are overwritten.writeChromeTrace() saves the ring in the chrome trace event format which
+/// chrome://tracing and perfetto both open
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include<vector>
+#include<string>
+#include<atomic>
+#include<chrono>
+
+//-----------------------------------------------
+/// @brief one timed span
+//---------------------------------------------------
+struct traceEvent
+{
+    //------------------
+    /// @brief name of the span,must be a string literal
+    //--------------------
+    const char *m_name;
+    //------------------
+    /// @brief start in microseconds since the recorder was created
+    //--------------------
+    double m_start;
+    //------------------
+    /// @brief length in microseconds
+    //--------------------
+    double m_duration;
+    //------------------
+    /// @brief small id of the thread that recorded the span
+    //--------------------
+    unsigned int m_thread;
+};
+
+class TraceRecorder
+{
+public:
+  //-----------------------------------------------
+  /// @brief the single recorder,created on first use
+  //---------------------------------------------------
+  static TraceRecorder *instance();
+
+  //-----------------------------------------------
+  /// @brief start or stop recording,off by default
+  //---------------------------------------------------
+  inline void setEnabled(bool _enabled) { m_enabled = _enabled;}
+  //-----------------------------------------------
+  /// @brief true while spans are recorded
+  //---------------------------------------------------
+  inline bool isEnabled() const { return m_enabled;}
+
+  //-----------------------------------------------
+  /// @brief change the number of spans kept,this clears the ring.
+  /// only call it while no other thread is recording
+  //---------------------------------------------------
+  void setCapacity(unsigned int _capacity);
+
+  //-----------------------------------------------
+  /// @brief forget every span
+  //---------------------------------------------------
+  void clear();
+
+  //-----------------------------------------------
+  /// @brief microseconds since the recorder was created
+  //---------------------------------------------------
+  double now() const;
+
+  //-----------------------------------------------
+  /// @brief store a span
+  /// @param[in] _name string literal naming the span
+  /// @param[in] _start start time from now()
+  /// @param[in] _end end time from now()
+  //---------------------------------------------------
+  void record(const char *_name, double _start, double _end);
+
+  //-----------------------------------------------
+  /// @brief save the ring,oldest span first,as chrome trace json.
+  /// recording is paused while the ring is copied
+  /// @param[in] _fname file to write
+  /// @returns false if the file could not be written
+  //---------------------------------------------------
+  bool writeChromeTrace(const std::string &_fname);
+
+  //-----------------------------------------------
+  /// @brief a small id for the calling thread,0 for the first thread that asks
+  //---------------------------------------------------
+  static unsigned int threadId();
+
+private:
+  typedef std::chrono::steady_clock Clock;
+  //-----------------------------------------------
+  /// @brief private constructor,use instance()
+  //---------------------------------------------------
+  TraceRecorder();
+  //-----------------------------------------------
+  /// @brief the ring of spans
+  //---------------------------------------------------
+  std::vector<traceEvent> m_events;
+  //-----------------------------------------------
+  /// @brief total number of spans recorded,the next slot is this modulo the capacity
+  //---------------------------------------------------
+  std::atomic<unsigned long long> m_next;
+  //-----------------------------------------------
+  /// @brief recording on or off
+  //---------------------------------------------------
+  std::atomic<bool> m_enabled;
+  //-----------------------------------------------
+  /// @brief time 0 of the trace
+  //---------------------------------------------------
+  Clock::time_point m_origin;
+};
+
+//-----------------------------------------------
+/// @brief records a span from construction to the end of the scope when the recorder is on
+//---------------------------------------------------
+struct traceScope
+{
+  traceScope(const char *_name) : m_name(_name)
+  {
+    TraceRecorder *trace = TraceRecorder::instance();
+    m_active = trace->isEnabled();
+    m_start = m_active ? trace->now() : 0;
+  }
+  ~traceScope()
+  {
+    if (m_active) {
+      TraceRecorder *trace = TraceRecorder::instance();
+      trace->record(m_name, m_start, trace->now());
+    }
+  }
+  const char *m_name;
+  double m_start;
+  bool m_active;
+};
+
+#endif // TRACERECORDER_H
@@ -0,0 +1,130 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file WorkerPool.h
+/// @brief a small persistent thread pool used to split per vertex work across cores
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+/// @class WorkerPool
+/// @brief the worker threads are created once and sleep between jobs, so running a job
+/// every frame does not create or destroy any threads.
+/// a job is a range [0,count) that is cut into contiguous blocks, one block per thread,
+/// the calling thread works on the first block and waits for the others to finish
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include<vector>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+
+class WorkerPool
+{
+public:
+  //-----------------------------------------------
+  /// @brief the job signature,it is called with the first and one past the last index of a block
+  //---------------------------------------------------
+  typedef std::function<void(unsigned int _begin, unsigned int _end)> RangeJob;
+
+  //-----------------------------------------------
+  /// @brief constructor
+  /// @param[in] _nThreads total number of threads including the caller,0 uses all hardware threads
+  //---------------------------------------------------
+  WorkerPool(unsigned int _nThreads=0);
+
+  //-----------------------------------------------
+  /// @brief destructor,wakes up and joins all the workers
+  //---------------------------------------------------
+  ~WorkerPool();
+
+  //-----------------------------------------------
+  /// @brief change the number of threads,the existing workers are joined and new ones started
+  /// @param[in] _nThreads total number of threads including the caller,0 uses all hardware threads
+  //---------------------------------------------------
+  void setNumThreads(unsigned int _nThreads);
+
+  //-----------------------------------------------
+  /// @brief accessor for the total number of threads including the caller
+  //---------------------------------------------------
+  inline unsigned int numThreads() const { return m_workers.size()+1;}
+
+  //-----------------------------------------------
+  /// @brief run a job over [0,_count) and block until every block is done
+  /// the blocks only depend on the count and thread number so a job that writes
+  /// each index independently gives the same result for any number of threads
+  /// @param[in] _count size of the range
+  /// @param[in] _job function called once per block
+  /// @param[in] _minBlock smallest block worth sending to another thread
+  //---------------------------------------------------
+  void parallelFor(unsigned int _count, const RangeJob &_job, unsigned int _minBlock=1024);
+
+private:
+  //-----------------------------------------------
+  /// @brief not copyable
+  //---------------------------------------------------
+  WorkerPool(const WorkerPool &);
+  WorkerPool &operator=(const WorkerPool &);
+
+  //-----------------------------------------------
+  /// @brief start the worker threads
+  //---------------------------------------------------
+  void startWorkers(unsigned int _nThreads);
+  //-----------------------------------------------
+  /// @brief join the worker threads
+  //---------------------------------------------------
+  void stopWorkers();
+  //-----------------------------------------------
+  /// @brief loop run by each worker,it sleeps until a new job is posted
+  /// @param[in] _block index of the block this worker owns
+  /// @param[in] _generation job generation at the time the worker was started
+  //---------------------------------------------------
+  void workerLoop(unsigned int _block, unsigned int _generation);
+  //-----------------------------------------------
+  /// @brief the block boundaries of the current job
+  //---------------------------------------------------
+  void blockRange(unsigned int _block, unsigned int &o_begin, unsigned int &o_end) const;
+
+  //-----------------------------------------------
+  /// @brief the worker threads,the caller is not stored
+  //---------------------------------------------------
+  std::vector<std::thread> m_workers;
+  //-----------------------------------------------
+  /// @brief guards the job state below
+  //---------------------------------------------------
+  std::mutex m_mutex;
+  //-----------------------------------------------
+  /// @brief signalled when a job is posted or the pool shuts down
+  //---------------------------------------------------
+  std::condition_variable m_wake;
+  //-----------------------------------------------
+  /// @brief signalled when the last worker finishes its block
+  //---------------------------------------------------
+  std::condition_variable m_done;
+  //-----------------------------------------------
+  /// @brief the job being run,only valid while a job is in flight
+  //---------------------------------------------------
+  const RangeJob *m_job;
+  //-----------------------------------------------
+  /// @brief size of the current range
+  //---------------------------------------------------
+  unsigned int m_count;
+  //-----------------------------------------------
+  /// @brief number of blocks the current range is cut into
+  //---------------------------------------------------
+  unsigned int m_nBlocks;
+  //-----------------------------------------------
+  /// @brief incremented for every job so the workers know there is new work
+  //---------------------------------------------------
+  unsigned int m_generation;
+  //-----------------------------------------------
+  /// @brief number of workers still running the current job
+  //---------------------------------------------------
+  unsigned int m_pending;
+  //-----------------------------------------------
+  /// @brief set on shut down
+  //---------------------------------------------------
+  bool m_quit;
+};
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,194 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AnimClip.cpp
+/// @brief member fucntions of class AnimClip
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include "AnimClip.h"
+#include "AssetCache.h"
+#include<cmath>
+#include<algorithm>
+
+// a channel is stored once when no component moves more than this
+const static float CONSTANT_TOLERANCE = 1e-5f;
+
+AnimClip::AnimClip()
+{
+  clear();
+}
+
+void AnimClip::clear()
+{
+  m_duration = 0;
+  m_sampleRate = 1;
+  m_nFrames = 0;
+  m_tracks.clear();
+  m_rotData.clear();
+  m_vecData.clear();
+}
+
+void AnimClip::begin(float _duration, float _sampleRate, unsigned int _nTracks)
+{
+  clear();
+  m_duration = _duration;
+  m_sampleRate = _sampleRate > 0 ? _sampleRate : 1;
+  //one sample at each end of the clip,the rate is raised so a whole number of steps covers
+  //the duration and the last sample lands on the end of the clip like the others
+  unsigned int nSteps = std::max(1.0f, std::ceil(m_duration * m_sampleRate));
+  if (m_duration > 0) {
+    m_sampleRate = nSteps / m_duration;
+  }
+  m_nFrames = nSteps + 1;
+  m_tracks.resize(_nTracks);
+}
+
+unsigned int AnimClip::memorySize() const
+{
+  return m_tracks.size() * sizeof(clipTrack) +
+         m_rotData.size() * sizeof(short) +
+         m_vecData.size() * sizeof(unsigned short);
+}
+
+void AnimClip::storeChannel(const std::vector<ngl::Vec3> &_values, vecChannel &o_channel)
+{
+  float lo[3] = {_values[0].m_x, _values[0].m_y, _values[0].m_z};
+  float hi[3] = {lo[0], lo[1], lo[2]};
+  for (unsigned int i = 1; i < _values.size(); ++i) {
+    const float v[3] = {_values[i].m_x, _values[i].m_y, _values[i].m_z};
+    for (int c = 0; c < 3; ++c) {
+      lo[c] = std::min(lo[c], v[c]);
+      hi[c] = std::max(hi[c], v[c]);
+    }
+  }
+  bool constant = true;
+  for (int c = 0; c < 3; ++c) {
+    if (hi[c] - lo[c] > CONSTANT_TOLERANCE * std::max(1.0f, std::fabs(lo[c]))) {
+      constant = false;
+    }
+  }
+  o_channel.m_offset = m_vecData.size();
+  if (constant) {
+    //a single sample of 0 decodes to the minimum
+    o_channel.m_stride = 0;
+    for (int c = 0; c < 3; ++c) {
+      o_channel.m_min[c] = 0.5f * (lo[c] + hi[c]);
+      o_channel.m_step[c] = 0;
+      m_vecData.push_back(0);
+    }
+    return;
+  }
+  o_channel.m_stride = 3;
+  for (int c = 0; c < 3; ++c) {
+    o_channel.m_min[c] = lo[c];
+    o_channel.m_step[c] = (hi[c] - lo[c]) / 65535.0f;
+  }
+  for (unsigned int i = 0; i < _values.size(); ++i) {
+    const float v[3] = {_values[i].m_x, _values[i].m_y, _values[i].m_z};
+    for (int c = 0; c < 3; ++c) {
+      float q = o_channel.m_step[c] > 0 ? (v[c] - lo[c]) / o_channel.m_step[c] : 0;
+      m_vecData.push_back((unsigned short)std::min(65535.0f, std::floor(q + 0.5f)));
+    }
+  }
+}
+
+void AnimClip::setTrack(
+                         unsigned int _track,
+                         const std::vector<ngl::Vec3> &_pos,
+                         const std::vector<ngl::Quaternion> &_rot,
+                         const std::vector<ngl::Vec3> &_scale
+                       )
+{
+  clipTrack &track = m_tracks[_track];
+  storeChannel(_pos, track.m_pos);
+  storeChannel(_scale, track.m_scale);
+
+  //keep neighbouring rotations in the same hemisphere so sampling needs no sign check
+  std::vector<ngl::Quaternion> rot(_rot);
+  bool constant = true;
+  for (unsigned int i = 1; i < rot.size(); ++i) {
+    const ngl::Quaternion &p = rot[i - 1];
+    ngl::Quaternion &q = rot[i];
+    if (p.getX() * q.getX() + p.getY() * q.getY() + p.getZ() * q.getZ() + p.getS() * q.getS() < 0) {
+      q = ngl::Quaternion(-q.getS(), -q.getX(), -q.getY(), -q.getZ());
+    }
+    if (std::fabs(q.getX() - rot[0].getX()) > CONSTANT_TOLERANCE ||
+        std::fabs(q.getY() - rot[0].getY()) > CONSTANT_TOLERANCE ||
+        std::fabs(q.getZ() - rot[0].getZ()) > CONSTANT_TOLERANCE ||
+        std::fabs(q.getS() - rot[0].getS()) > CONSTANT_TOLERANCE) {
+      constant = false;
+    }
+  }
+  track.m_rotOffset = m_rotData.size();
+  track.m_rotStride = constant ? 0 : 4;
+  unsigned int nSamples = constant ? 1 : rot.size();
+  for (unsigned int i = 0; i < nSamples; ++i) {
+    const float v[4] = {rot[i].getX(), rot[i].getY(), rot[i].getZ(), rot[i].getS()};
+    for (int c = 0; c < 4; ++c) {
+      m_rotData.push_back((short)std::floor(std::max(-1.0f, std::min(1.0f, v[c])) * 32767.0f + 0.5f));
+    }
+  }
+}
+
+ngl::Vec3 AnimClip::sampleChannel(const vecChannel &_channel, unsigned int _i0, unsigned int _i1, float _t) const
+{
+  const unsigned short *a = &m_vecData[_channel.m_offset + _i0 * _channel.m_stride];
+  const unsigned short *b = &m_vecData[_channel.m_offset + _i1 * _channel.m_stride];
+  float v[3];
+  for (int c = 0; c < 3; ++c) {
+    float q = a[c] + (b[c] - (float)a[c]) * _t;
+    v[c] = _channel.m_min[c] + q * _channel.m_step[c];
+  }
+  return ngl::Vec3(v[0], v[1], v[2]);
+}
+
+void AnimClip::sample(unsigned int _track, float _time, ngl::Vec3 &o_pos, ngl::Quaternion &o_rot, ngl::Vec3 &o_scale) const
+{
+  const clipTrack &track = m_tracks[_track];
+  //the two samples either side of the time and how far between them
+  float frame = std::max(0.0f, std::min(_time * m_sampleRate, (float)(m_nFrames - 1)));
+  unsigned int i0 = std::min((unsigned int)frame, m_nFrames - 2);
+  unsigned int i1 = i0 + 1;
+  float t = frame - i0;
+
+  o_pos = sampleChannel(track.m_pos, i0, i1, t);
+  o_scale = sampleChannel(track.m_scale, i0, i1, t);
+
+  //normalised lerp,the samples were aligned when the clip was baked
+  const short *a = &m_rotData[track.m_rotOffset + i0 * track.m_rotStride];
+  const short *b = &m_rotData[track.m_rotOffset + i1 * track.m_rotStride];
+  float q[4];
+  float len2 = 0;
+  for (int c = 0; c < 4; ++c) {
+    q[c] = a[c] + (b[c] - (float)a[c]) * t;
+    len2 += q[c] * q[c];
+  }
+  float invLength = len2 > 0 ? 1.0f / std::sqrt(len2) : 0;
+  o_rot = ngl::Quaternion(q[3] * invLength, q[0] * invLength, q[1] * invLength, q[2] * invLength);
+}
+
+void AnimClip::write(AssetCacheWriter &_cache) const
+{
+  _cache.writeValue(m_duration);
+  _cache.writeValue(m_sampleRate);
+  _cache.writeValue(m_nFrames);
+  _cache.writeArray(m_tracks);
+  _cache.writeArray(m_rotData);
+  _cache.writeArray(m_vecData);
+}
+
+bool AnimClip::read(AssetCacheReader &_cache)
+{
+  clear();
+  _cache.readValue(m_duration);
+  _cache.readValue(m_sampleRate);
+  _cache.readValue(m_nFrames);
+  _cache.readArray(m_tracks);
+  _cache.readArray(m_rotData);
+  _cache.readArray(m_vecData);
+  if (_cache.failed() || m_nFrames < 2 || m_sampleRate <= 0) {
+    clear();
+    return false;
+  }
+  return true;
+}
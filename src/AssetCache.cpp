@@ -0,0 +1,141 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AssetCache.cpp
+/// @brief member fucntions of class AssetCacheWriter and AssetCacheReader
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include "AssetCache.h"
+#include<cstdio>
+#include<fstream>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+
+// first bytes of every cache file,bump the version when the layout of anything cached changes
+const static char CACHE_MAGIC[4] = {'L', 'B', 'S', 'C'};
+const static uint32_t CACHE_VERSION = 9;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief map a whole file read only
+/// @returns NULL if it could not be opened or is empty
+//----------------------------------------------------------------------------------------------------------------------
+static const char *mapFile(const std::string &_fname, size_t &o_size)
+{
+  int fd = ::open(_fname.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat info;
+  const char *data = NULL;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    o_size = info.st_size;
+    void *map = mmap(NULL, o_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    data = map != MAP_FAILED ? (const char *)map : NULL;
+  }
+  //the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  return data;
+}
+
+bool AssetCache::hashFile(const std::string &_fname, uint64_t &o_hash)
+{
+  size_t size = 0;
+  const char *data = mapFile(_fname, size);
+  if (!data) {
+    return false;
+  }
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ULL;
+  }
+  munmap((void *)data, size);
+  o_hash = hash;
+  return true;
+}
+
+AssetCacheWriter::AssetCacheWriter(uint64_t _sourceHash)
+{
+  append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  writeValue(CACHE_VERSION);
+  writeValue(_sourceHash);
+}
+
+void AssetCacheWriter::append(const void *_data, size_t _size)
+{
+  const char *bytes = (const char *)_data;
+  m_data.insert(m_data.end(), bytes, bytes + _size);
+}
+
+bool AssetCacheWriter::save(const std::string &_fname) const
+{
+  std::string tmpName = _fname + ".tmp";
+  std::ofstream file(tmpName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+  file.write(&m_data[0], m_data.size());
+  file.close();
+  if (file.fail()) {
+    std::remove(tmpName.c_str());
+    return false;
+  }
+  return std::rename(tmpName.c_str(), _fname.c_str()) == 0;
+}
+
+AssetCacheReader::AssetCacheReader()
+{
+  m_data = NULL;
+  m_size = 0;
+  m_offset = 0;
+  m_failed = false;
+}
+
+AssetCacheReader::~AssetCacheReader()
+{
+  close();
+}
+
+bool AssetCacheReader::open(const std::string &_fname, uint64_t _sourceHash)
+{
+  close();
+  m_data = mapFile(_fname, m_size);
+  if (!m_data) {
+    return false;
+  }
+  //the header must match before anything else is read
+  const char *magic = take(sizeof(CACHE_MAGIC));
+  uint32_t version = 0;
+  uint64_t sourceHash = 0;
+  if (!magic || memcmp(magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      !readValue(version) || version != CACHE_VERSION ||
+      !readValue(sourceHash) || sourceHash != _sourceHash) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void AssetCacheReader::close()
+{
+  if (m_data) {
+    munmap((void *)m_data, m_size);
+  }
+  m_data = NULL;
+  m_size = 0;
+  m_offset = 0;
+  m_failed = false;
+}
+
+const char *AssetCacheReader::take(size_t _size)
+{
+  if (m_failed || !m_data || _size > m_size - m_offset) {
+    m_failed = true;
+    return NULL;
+  }
+  const char *src = m_data + m_offset;
+  m_offset += _size;
+  return src;
+}
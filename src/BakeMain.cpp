@@ -0,0 +1,148 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BakeMain.cpp
+/// @brief headless tool that imports scene files and writes their binary caches,
+/// so the viewer never has to run assimp on them
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include<iostream>
+#include<cstdlib>
+#include<string>
+#include<vector>
+#include<atomic>
+#include<mutex>
+#include<dirent.h>
+#include<sys/stat.h>
+
+#include "SceneLoader.h"
+#include "WorkerPool.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief true if the name ends with one of the extensions assimp is asked to bake
+//----------------------------------------------------------------------------------------------------------------------
+static bool isSceneFile(const std::string &_name)
+{
+  const char *extensions[] = {".dae", ".fbx", ".x", ".md5mesh"};
+  for (unsigned int i = 0; i < sizeof(extensions) / sizeof(extensions[0]); ++i) {
+    std::string ext(extensions[i]);
+    if (_name.size() > ext.size() && _name.compare(_name.size() - ext.size(), ext.size(), ext) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief add a file,or every scene file found under a directory,to the list
+//----------------------------------------------------------------------------------------------------------------------
+static void collectFiles(const std::string &_path, std::vector<std::string> &io_files)
+{
+  struct stat info;
+  if (stat(_path.c_str(), &info) != 0) {
+    std::cerr << "cannot find " << _path << "\n";
+    return;
+  }
+  if (!S_ISDIR(info.st_mode)) {
+    io_files.push_back(_path);
+    return;
+  }
+  DIR *dir = opendir(_path.c_str());
+  if (!dir) {
+    return;
+  }
+  while (struct dirent *entry = readdir(dir)) {
+    std::string name(entry->d_name);
+    if (name == "." || name == "..") {
+      continue;
+    }
+    std::string child = _path + "/" + name;
+    if (stat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+      collectFiles(child, io_files);
+    } else if (isSceneFile(name)) {
+      io_files.push_back(child);
+    }
+  }
+  closedir(dir);
+}
+
+static void usage()
+{
+  std::cerr << "usage: LBSkinBake [-r samplesPerSecond] [-i maxInfluences] [-w weightBits] [-keep] [-j threads] files or directories\n"
+            << "  -r  animation bake rate,default 60\n"
+            << "  -i  bones kept per vertex,0 keeps all,default 4\n"
+            << "  -w  bits per skin weight,32 16 or 8,default 16\n"
+            << "  -keep  keep the vertex order of the file instead of sorting the vertices by bone\n"
+            << "  -j  number of files baked at once,0 uses all cores,default 0\n";
+}
+
+int main(int argc, char **argv)
+{
+  //the defaults are the settings the viewer loads with,so its cache lookups hit
+  float bakeRate = 60;
+  unsigned int maxInfluences = 4;
+  unsigned int weightBits = 16;
+  bool reorderVertices = true;
+  unsigned int nThreads = 0;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if ((arg == "-r" || arg == "-i" || arg == "-w" || arg == "-j") && i + 1 < argc) {
+      int value = atoi(argv[++i]);
+      if (arg == "-r") {
+        bakeRate = (float)atof(argv[i]);
+      } else if (arg == "-i") {
+        maxInfluences = value > 0 ? value : 0;
+      } else if (arg == "-w") {
+        weightBits = value;
+      } else {
+        nThreads = value > 0 ? value : 0;
+      }
+    } else if (arg == "-keep") {
+      reorderVertices = false;
+    } else if (arg[0] == '-') {
+      usage();
+      return EXIT_FAILURE;
+    } else {
+      collectFiles(arg, files);
+    }
+  }
+  if (files.empty() || bakeRate <= 0 || (weightBits != 32 && weightBits != 16 && weightBits != 8)) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  //every thread takes the next file when it is done with one,files vary a lot in size
+  //so a fixed split would leave threads idle
+  WorkerPool workers(nThreads);
+  std::atomic<unsigned int> next(0);
+  std::atomic<unsigned int> nFailed(0);
+  std::mutex outputLock;
+  workers.parallelFor(workers.numThreads(), [&](unsigned int _begin, unsigned int _end)
+  {
+    for (unsigned int f = next++; f < files.size(); f = next++) {
+      SceneLoader scene;
+      scene.setBakeRate(bakeRate);
+      scene.setMaxInfluences(maxInfluences);
+      scene.setWeightBits(weightBits);
+      scene.setReorderVertices(reorderVertices);
+      bool baked = scene.load(files[f]) && scene.hasValidCache();
+      std::lock_guard<std::mutex> lock(outputLock);
+      if (baked) {
+        unsigned int clipBytes = 0;
+        for (unsigned int c = 0; c < scene.numClips(); ++c) {
+          clipBytes += scene.getClip(c).memorySize();
+        }
+        std::cout << files[f] << " : " << scene.getMeshes().size() << " meshes " << scene.getNumVerts() << " verts "
+                  << scene.numBones() << " bones " << scene.numClips() << " clips "
+                  << (scene.numClips() ? scene.getClip(0).numTracks() : 0) << " tracks " << clipBytes << " clip bytes "
+                  << scene.m_influences.memorySize() << " skin bytes\n";
+      } else {
+        std::cerr << files[f] << " : failed\n";
+        ++nFailed;
+      }
+    }
+  }, 1);
+
+  return nFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,424 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BenchMain.cpp
+/// @brief headless skinning benchmark,loads scene files,sweeps the animation and times
+/// every stage of a frame without a window or GL context
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include<iostream>
+#include<fstream>
+#include<cstdlib>
+#include<string>
+#include<vector>
+#include<chrono>
+#include<algorithm>
+#include<dirent.h>
+#include<sys/stat.h>
+
+#include "SceneLoader.h"
+#include "SkinDeformer.h"
+#include "SkinCrowd.h"
+#include "TraceRecorder.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the stages of a frame that are timed,the deform stages follow the SkinDeformTypes order
+//----------------------------------------------------------------------------------------------------------------------
+enum BenchStage
+{
+  STAGE_POSE,STAGE_LINEAR_BLEND,STAGE_DUAL_QUATERNION,STAGE_STRETCH_TWIST,STAGE_PREPARE_DRAW,NUM_STAGES
+};
+const static char *STAGE_NAMES[NUM_STAGES] = {"pose", "linear_blend", "dual_quaternion", "stretch_twist", "prepare_draw"};
+// frames run before timing so the caches and worker threads are warm
+const static unsigned int WARMUP_FRAMES = 10;
+// poses compared by -check and the largest position or normal difference allowed between
+// the reference deformers and the kernels
+const static unsigned int CHECK_POSES = 8;
+const static float CHECK_TOLERANCE = 1e-3f;
+
+typedef std::chrono::steady_clock BenchClock;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief nanoseconds between two clock readings
+//----------------------------------------------------------------------------------------------------------------------
+static double elapsedNs(const BenchClock::time_point &_start, const BenchClock::time_point &_end)
+{
+  return std::chrono::duration<double, std::nano>(_end - _start).count();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief every .dae file directly inside a directory,or the path itself if it is a file
+//----------------------------------------------------------------------------------------------------------------------
+static void collectFiles(const std::string &_path, std::vector<std::string> &io_files)
+{
+  struct stat info;
+  if (stat(_path.c_str(), &info) != 0) {
+    std::cerr << "cannot find " << _path << "\n";
+    return;
+  }
+  if (!S_ISDIR(info.st_mode)) {
+    io_files.push_back(_path);
+    return;
+  }
+  DIR *dir = opendir(_path.c_str());
+  if (!dir) {
+    return;
+  }
+  while (struct dirent *entry = readdir(dir)) {
+    std::string name(entry->d_name);
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".dae") == 0) {
+      io_files.push_back(_path + "/" + name);
+    }
+  }
+  closedir(dir);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief read a rig size given as verts,bones,influences,seconds,missing values keep the defaults
+//----------------------------------------------------------------------------------------------------------------------
+static rigSettings parseRig(const std::string &_arg)
+{
+  rigSettings settings;
+  float values[4] = {(float)settings.m_nVerts, (float)settings.m_nBones, (float)settings.m_nInfluences, settings.m_length};
+  size_t start = 0;
+  for (int i = 0; i < 4 && start <= _arg.size(); ++i) {
+    size_t end = _arg.find(',', start);
+    std::string field = _arg.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    if (!field.empty()) {
+      values[i] = (float)atof(field.c_str());
+    }
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+  settings.m_nVerts = values[0] > 0 ? (unsigned int)values[0] : 0;
+  settings.m_nBones = values[1] > 0 ? (unsigned int)values[1] : 1;
+  settings.m_nInfluences = values[2] > 0 ? (unsigned int)values[2] : 1;
+  settings.m_length = values[3];
+  settings.m_sampleRate = 60;
+  return settings;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief compare the linear blend and dual quaternion kernels with the reference deformers over
+/// a few poses of the clip,the largest error of each is written to stderr
+/// @returns false if either is over CHECK_TOLERANCE
+//----------------------------------------------------------------------------------------------------------------------
+static bool checkScene(const std::string &_name, SceneLoader &_scene)
+{
+  SkinDeformer deformer;
+  deformer.setNumThreads(1);
+  deformer.setMeshData(&_scene, false);
+  std::vector<ngl::Mat4> transforms;
+  double ticksPerSec = _scene.getTicksPerSec() != 0 ? _scene.getTicksPerSec() : 25.0;
+  double length = _scene.getDuration() / ticksPerSec;
+  bool passed = true;
+  for (int a = LINEAR_BLEND; a <= DUAL_QUATERNION; ++a) {
+    deformer.setSkinAlgorithm(a);
+    ngl::Real maxError = 0;
+    for (unsigned int p = 0; p < CHECK_POSES; ++p) {
+      _scene.boneTransform(length * p / CHECK_POSES, transforms);
+      maxError = std::max(maxError, deformer.checkKernel());
+    }
+    bool ok = maxError <= CHECK_TOLERANCE;
+    std::cerr << _name << " : " << STAGE_NAMES[STAGE_LINEAR_BLEND + a] << " kernel error " << maxError
+              << (ok ? "" : " over tolerance") << "\n";
+    passed &= ok;
+  }
+  return passed;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief sweep the animation of a loaded scene and write one csv row per stage
+//----------------------------------------------------------------------------------------------------------------------
+static void benchScene(const std::string &_name, SceneLoader &_scene, unsigned int _nFrames, unsigned int _nThreads, std::ostream &_out)
+{
+  SkinDeformer deformer;
+  deformer.setNumThreads(_nThreads);
+  deformer.setMeshData(&_scene, false);
+  std::vector<ngl::Mat4> transforms;
+  double ticksPerSec = _scene.getTicksPerSec() != 0 ? _scene.getTicksPerSec() : 25.0;
+  double length = _scene.getDuration() / ticksPerSec;
+
+  double stageNs[NUM_STAGES] = {0, 0, 0, 0, 0};
+  for (unsigned int f = 0; f < WARMUP_FRAMES + _nFrames; ++f) {
+    bool timed = f >= WARMUP_FRAMES;
+    //sweep the whole clip once over the timed frames
+    float time = length * (f % _nFrames) / _nFrames;
+    BenchClock::time_point start = BenchClock::now();
+    _scene.boneTransform(time, transforms);
+    BenchClock::time_point end = BenchClock::now();
+    if (timed) {
+      stageNs[STAGE_POSE] += elapsedNs(start, end);
+    }
+    for (int a = LINEAR_BLEND; a <= STRETCH_TWIST; ++a) {
+      deformer.setSkinAlgorithm(a);
+      start = BenchClock::now();
+      deformer.deform();
+      end = BenchClock::now();
+      if (timed) {
+        stageNs[STAGE_LINEAR_BLEND + a] += elapsedNs(start, end);
+      }
+    }
+    start = BenchClock::now();
+    deformer.prepareDraw();
+    end = BenchClock::now();
+    if (timed) {
+      stageNs[STAGE_PREPARE_DRAW] += elapsedNs(start, end);
+    }
+  }
+
+  unsigned int nVerts = _scene.getNumVerts();
+  std::string prefix = _name + "," + std::to_string(nVerts) + "," + std::to_string(_scene.numBones()) + "," +
+                       std::to_string(deformer.getNumThreads()) + "," +
+                       SkinKernels::simdLevelName(deformer.getSimdLevel()) + "," +
+                       std::to_string(_scene.m_influences.m_weightBytes * 8) + ",";
+  for (int s = 0; s < NUM_STAGES; ++s) {
+    double frameNs = stageNs[s] / _nFrames;
+    _out << prefix << STAGE_NAMES[s] << "," << _nFrames << "," << stageNs[s] * 1e-6 << ","
+         << frameNs / nVerts << "," << (frameNs > 0 ? 1e9 / frameNs : 0) << "\n";
+  }
+  //a frame in the viewer is the pose,one deformer and the draw preparation
+  for (int a = LINEAR_BLEND; a <= STRETCH_TWIST; ++a) {
+    double total = stageNs[STAGE_POSE] + stageNs[STAGE_LINEAR_BLEND + a] + stageNs[STAGE_PREPARE_DRAW];
+    double frameNs = total / _nFrames;
+    _out << prefix << "frame_" << STAGE_NAMES[STAGE_LINEAR_BLEND + a] << "," << _nFrames << "," << total * 1e-6 << ","
+         << frameNs / nVerts << "," << (frameNs > 0 ? 1e9 / frameNs : 0) << "\n";
+  }
+  _out.flush();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief play a crowd of the loaded scene and write a row for the poses,the skinning and the two together,
+/// the time per vertex counts the vertices of every instance.a pose step caches the poses and tags the stage
+/// _cached,sharing the skinned meshes as well tags it _shared
+//----------------------------------------------------------------------------------------------------------------------
+static void benchCrowd(const std::string &_name, SceneLoader &_scene, unsigned int _nFrames, unsigned int _nThreads,
+                       unsigned int _nInstances, float _poseStep, bool _shareSkinned, std::ostream &_out)
+{
+  SkinCrowd crowd;
+  crowd.setNumThreads(_nThreads);
+  crowd.setMeshData(&_scene, false);
+  crowd.setPoseStep(_poseStep);
+  crowd.setShareSkinned(_shareSkinned);
+  crowd.layoutGrid(_nInstances);
+  double poseNs = 0, deformNs = 0;
+  for (unsigned int f = 0; f < WARMUP_FRAMES + _nFrames; ++f) {
+    crowd.advance(1.0f / 60);
+    BenchClock::time_point start = BenchClock::now();
+    crowd.updatePoses();
+    BenchClock::time_point mid = BenchClock::now();
+    crowd.deform();
+    BenchClock::time_point end = BenchClock::now();
+    if (f >= WARMUP_FRAMES) {
+      poseNs += elapsedNs(start, mid);
+      deformNs += elapsedNs(mid, end);
+    }
+  }
+
+  double nVerts = (double)_scene.getNumVerts() * _nInstances;
+  std::string prefix = _name + "," + std::to_string(_scene.getNumVerts()) + "," + std::to_string(_scene.numBones()) + "," +
+                       std::to_string(crowd.getNumThreads()) + "," +
+                       SkinKernels::simdLevelName(crowd.getSimdLevel()) + "," +
+                       std::to_string(_scene.m_influences.m_weightBytes * 8) + ",";
+  std::string stage = "crowd" + std::to_string(_nInstances);
+  if (_poseStep > 0) {
+    stage += _shareSkinned ? "_shared" : "_cached";
+  }
+  const char *names[3] = {"_pose", "_linear_blend", "_frame"};
+  double totals[3] = {poseNs, deformNs, poseNs + deformNs};
+  for (int s = 0; s < 3; ++s) {
+    double frameNs = totals[s] / _nFrames;
+    _out << prefix << stage << names[s] << "," << _nFrames << "," << totals[s] * 1e-6 << ","
+         << frameNs / nVerts << "," << (frameNs > 0 ? 1e9 / frameNs : 0) << "\n";
+  }
+  _out.flush();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief play the loaded scene at every level of detail it was loaded with,level l updating every l+1
+/// frames,and write a row for the pose and linear blend skinning of each level
+//----------------------------------------------------------------------------------------------------------------------
+static void benchLods(const std::string &_name, SceneLoader &_scene, unsigned int _nFrames, unsigned int _nThreads, std::ostream &_out)
+{
+  SkinDeformer deformer;
+  deformer.setNumThreads(_nThreads);
+  deformer.setMeshData(&_scene, false);
+  std::vector<ngl::Mat4> transforms;
+  double ticksPerSec = _scene.getTicksPerSec() != 0 ? _scene.getTicksPerSec() : 25.0;
+  double length = _scene.getDuration() / ticksPerSec;
+  unsigned int nVerts = _scene.getNumVerts();
+  for (unsigned int lod = 0; lod < _scene.numLods(); ++lod) {
+    deformer.setLod(lod);
+    deformer.setUpdateInterval(lod + 1);
+    double poseNs = 0, deformNs = 0;
+    for (unsigned int f = 0; f < WARMUP_FRAMES + _nFrames; ++f) {
+      float time = length * (f % _nFrames) / _nFrames;
+      BenchClock::time_point start = BenchClock::now();
+      if (deformer.needsPose()) {
+        _scene.boneTransform(time, transforms, lod);
+      }
+      BenchClock::time_point mid = BenchClock::now();
+      deformer.deform();
+      BenchClock::time_point end = BenchClock::now();
+      if (f >= WARMUP_FRAMES) {
+        poseNs += elapsedNs(start, mid);
+        deformNs += elapsedNs(mid, end);
+      }
+    }
+    std::string prefix = _name + "," + std::to_string(nVerts) + "," + std::to_string(_scene.numLodBones(lod)) + "," +
+                         std::to_string(deformer.getNumThreads()) + "," +
+                         SkinKernels::simdLevelName(deformer.getSimdLevel()) + "," +
+                         std::to_string(_scene.getInfluences(lod).m_weightBytes * 8) + ",";
+    std::string stage = "lod" + std::to_string(lod);
+    const char *names[2] = {"_pose", "_linear_blend"};
+    double totals[2] = {poseNs, deformNs};
+    for (int s = 0; s < 2; ++s) {
+      double frameNs = totals[s] / _nFrames;
+      _out << prefix << stage << names[s] << "," << _nFrames << "," << totals[s] * 1e-6 << ","
+           << frameNs / nVerts << "," << (frameNs > 0 ? 1e9 / frameNs : 0) << "\n";
+    }
+  }
+  _out.flush();
+}
+
+static void usage()
+{
+  std::cerr << "usage: LBSkinBench [-f frames] [-j threads] [-o file.csv] [-t trace.json] [-w bits] [-nosort] [-check] [-crowd n] [-q seconds] [-share] [-lod n] [-rig v,b,i,s] [files or directories]\n"
+            << "  -f    timed frames per model,default 200\n"
+            << "  -j    deformer threads,0 uses all cores,default 0\n"
+            << "  -o    write the results to a file instead of stdout\n"
+            << "  -t    record the timing spans of every thread and save them as a chrome trace\n"
+            << "  -w    bits per skin weight,32 16 or 8,default 16 as in the viewer\n"
+            << "  -nosort keep the file vertex order instead of sorting the vertices by bone as the viewer does\n"
+            << "  -check compare the kernels with the reference deformers first and fail if they differ\n"
+            << "  -crowd also time n instances of each model sharing its mesh\n"
+            << "  -q    snap the crowd poses to steps of this many seconds and cache them,default 0 is exact\n"
+            << "  -share with -q,skin each cached pose once and draw it for every instance using it\n"
+            << "  -lod  build n reduced skeletons and also time each of them\n"
+            << "  -rig  add a generated rig of v vertices,b bones,i influences per vertex and s seconds\n"
+            << "        of animation,can be given more than once.eg -rig 1000000,256,4,2\n"
+            << "  the default input is the models directory\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int nFrames = 200;
+  unsigned int nThreads = 0;
+  //the viewer settings so the models share its cache files
+  unsigned int weightBits = 16;
+  bool reorderVertices = true;
+  unsigned int nInstances = 0;
+  float poseStep = 0;
+  bool shareSkinned = false;
+  bool check = false;
+  unsigned int lodLevels = 0;
+  std::string outName;
+  std::string traceName;
+  std::vector<std::string> files;
+  std::vector<rigSettings> rigs;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if ((arg == "-f" || arg == "-j" || arg == "-w" || arg == "-crowd" || arg == "-lod") && i + 1 < argc) {
+      int value = atoi(argv[++i]);
+      if (arg == "-f") {
+        nFrames = value > 0 ? value : 1;
+      } else if (arg == "-w") {
+        weightBits = value;
+      } else if (arg == "-crowd") {
+        nInstances = value > 0 ? value : 0;
+      } else if (arg == "-lod") {
+        lodLevels = value > 0 ? value : 0;
+      } else {
+        nThreads = value > 0 ? value : 0;
+      }
+    } else if (arg == "-q" && i + 1 < argc) {
+      poseStep = std::max(0.0f, (float)atof(argv[++i]));
+    } else if (arg == "-share") {
+      shareSkinned = true;
+    } else if (arg == "-check") {
+      check = true;
+    } else if (arg == "-o" && i + 1 < argc) {
+      outName = argv[++i];
+    } else if (arg == "-t" && i + 1 < argc) {
+      traceName = argv[++i];
+    } else if (arg == "-nosort") {
+      reorderVertices = false;
+    } else if (arg == "-rig" && i + 1 < argc) {
+      rigs.push_back(parseRig(argv[++i]));
+    } else if (arg[0] == '-') {
+      usage();
+      return EXIT_FAILURE;
+    } else {
+      collectFiles(arg, files);
+    }
+  }
+  if (files.empty() && rigs.empty()) {
+    collectFiles("models", files);
+  }
+  if ((files.empty() && rigs.empty()) || (weightBits != 32 && weightBits != 16 && weightBits != 8)) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  std::ofstream outFile;
+  if (!outName.empty()) {
+    outFile.open(outName.c_str());
+  }
+  std::ostream &out = outFile.is_open() ? outFile : std::cout;
+  TraceRecorder::instance()->setEnabled(!traceName.empty());
+
+  //one csv row per model and stage,plus a row per algorithm for the whole frame
+  out << "model,vertices,bones,threads,simd,weight_bits,stage,frames,total_ms,ns_per_vertex,fps\n";
+  int status = EXIT_SUCCESS;
+  for (unsigned int m = 0; m < files.size(); ++m) {
+    SceneLoader scene;
+    scene.setBakeRate(60);
+    scene.setMaxInfluences(4);
+    scene.setWeightBits(weightBits);
+    scene.setReorderVertices(reorderVertices);
+    scene.setLodLevels(lodLevels);
+    if (!scene.load(files[m]) || scene.numBones() == 0) {
+      std::cerr << files[m] << " : no skinned mesh\n";
+      status = EXIT_FAILURE;
+      continue;
+    }
+    if (check && !checkScene(files[m], scene)) {
+      status = EXIT_FAILURE;
+    }
+    benchScene(files[m], scene, nFrames, nThreads, out);
+    if (lodLevels > 0) {
+      benchLods(files[m], scene, nFrames, nThreads, out);
+    }
+    if (nInstances > 0) {
+      benchCrowd(files[m], scene, nFrames, nThreads, nInstances, poseStep, shareSkinned, out);
+    }
+  }
+  for (unsigned int r = 0; r < rigs.size(); ++r) {
+    SceneLoader scene;
+    scene.setWeightBits(weightBits);
+    scene.setReorderVertices(reorderVertices);
+    scene.setLodLevels(lodLevels);
+    scene.loadRig(rigs[r]);
+    if (scene.getNumVerts() == 0) {
+      continue;
+    }
+    std::string name = "rig_" + std::to_string(rigs[r].m_nVerts) + "v_" + std::to_string(rigs[r].m_nBones) + "b_" +
+                       std::to_string(rigs[r].m_nInfluences) + "i";
+    if (check && !checkScene(name, scene)) {
+      status = EXIT_FAILURE;
+    }
+    benchScene(name, scene, nFrames, nThreads, out);
+    if (lodLevels > 0) {
+      benchLods(name, scene, nFrames, nThreads, out);
+    }
+    if (nInstances > 0) {
+      benchCrowd(name, scene, nFrames, nThreads, nInstances, poseStep, shareSkinned, out);
+    }
+  }
+  if (!traceName.empty() && !TraceRecorder::instance()->writeChromeTrace(traceName)) {
+    std::cerr << "cannot write " << traceName << "\n";
+    status = EXIT_FAILURE;
+  }
+  return status;
+}
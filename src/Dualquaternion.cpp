@@ -57,7 +57,7 @@ void DualQuaternion::operator*=(const DualQuaternion _dq)
   *this = *this * _dq;
 }
 
-DualQuaternion DualQuaternion::operator *(ngl::Real _r)
+DualQuaternion DualQuaternion::operator *(ngl::Real _r) const
 {
   DualQuaternion t(m_real * _r, m_dual * _r);
   return t;
@@ -0,0 +1,150 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameProfiler.cpp
+/// @brief member fucntions of class FrameProfiler
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include "FrameProfiler.h"
+#include<algorithm>
+
+FrameProfiler::FrameProfiler(unsigned int _window)
+{
+  m_window = _window > 0 ? _window : 1;
+  for (int i = 0; i < PROFILE_NUM_STAGES; ++i) {
+    m_samples[i].assign(m_window, 0.0f);
+    m_next[i] = 0;
+    m_count[i] = 0;
+  }
+  m_frameStarted = false;
+  for (unsigned int i = 0; i < GPU_QUERIES; ++i) {
+    m_queries[i] = 0;
+    m_queryPending[i] = false;
+  }
+  m_nextQuery = 0;
+  m_gpuActive = false;
+  m_gpuReady = false;
+}
+
+void FrameProfiler::initGPU()
+{
+  if (m_gpuReady) {
+    return;
+  }
+  glGenQueries(GPU_QUERIES, m_queries);
+  m_gpuReady = true;
+}
+
+void FrameProfiler::releaseGPU()
+{
+  if (!m_gpuReady) {
+    return;
+  }
+  glDeleteQueries(GPU_QUERIES, m_queries);
+  for (unsigned int i = 0; i < GPU_QUERIES; ++i) {
+    m_queries[i] = 0;
+    m_queryPending[i] = false;
+  }
+  m_gpuActive = false;
+  m_gpuReady = false;
+}
+
+void FrameProfiler::beginFrame()
+{
+  Clock::time_point now = Clock::now();
+  if (m_frameStarted) {
+    addSample(PROFILE_FRAME, std::chrono::duration<float, std::milli>(now - m_lastFrame).count());
+  }
+  m_lastFrame = now;
+  m_frameStarted = true;
+  collectGPU();
+}
+
+void FrameProfiler::begin(ProfileStage _stage)
+{
+  m_start[_stage] = Clock::now();
+}
+
+void FrameProfiler::end(ProfileStage _stage)
+{
+  addSample(_stage, std::chrono::duration<float, std::milli>(Clock::now() - m_start[_stage]).count());
+}
+
+void FrameProfiler::beginGPU()
+{
+  m_gpuActive = false;
+  //the query is still waiting for an old frame,skip this one rather than stall
+  if (!m_gpuReady || m_queryPending[m_nextQuery]) {
+    return;
+  }
+  glBeginQuery(GL_TIME_ELAPSED, m_queries[m_nextQuery]);
+  m_gpuActive = true;
+}
+
+void FrameProfiler::endGPU()
+{
+  if (!m_gpuActive) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED);
+  m_queryPending[m_nextQuery] = true;
+  m_nextQuery = (m_nextQuery + 1) % GPU_QUERIES;
+  m_gpuActive = false;
+}
+
+void FrameProfiler::collectGPU()
+{
+  if (!m_gpuReady) {
+    return;
+  }
+  //oldest first so the samples stay in frame order
+  for (unsigned int i = 0; i < GPU_QUERIES; ++i) {
+    unsigned int q = (m_nextQuery + i) % GPU_QUERIES;
+    if (!m_queryPending[q]) {
+      continue;
+    }
+    GLint available = 0;
+    glGetQueryObjectiv(m_queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(m_queries[q], GL_QUERY_RESULT, &ns);
+    addSample(PROFILE_GPU_DRAW, ns * 1e-6f);
+    m_queryPending[q] = false;
+  }
+}
+
+void FrameProfiler::addSample(ProfileStage _stage, float _ms)
+{
+  m_samples[_stage][m_next[_stage]] = _ms;
+  m_next[_stage] = (m_next[_stage] + 1) % m_window;
+  m_count[_stage] = std::min(m_count[_stage] + 1, m_window);
+}
+
+unsigned int FrameProfiler::stats(ProfileStage _stage, float &o_min, float &o_avg, float &o_p99) const
+{
+  unsigned int n = m_count[_stage];
+  o_min = o_avg = o_p99 = 0;
+  if (n == 0) {
+    return 0;
+  }
+  //the ring is full or filled from 0,either way the first n entries are the samples
+  std::vector<float> sorted(m_samples[_stage].begin(), m_samples[_stage].begin() + n);
+  float total = 0;
+  for (unsigned int i = 0; i < n; ++i) {
+    total += sorted[i];
+  }
+  unsigned int p99 = std::min(n - 1, (unsigned int)(0.99f * n));
+  std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+  o_p99 = sorted[p99];
+  o_min = *std::min_element(sorted.begin(), sorted.end());
+  o_avg = total / n;
+  return n;
+}
+
+const char *FrameProfiler::stageName(ProfileStage _stage)
+{
+  const static char *names[PROFILE_NUM_STAGES] = {"frame", "pose", "skin", "upload", "draw", "gpu draw"};
+  return names[_stage];
+}
@@ -10,6 +10,7 @@
 #include<QFile>
 #include<QGuiApplication>
 #include<string>
+#include"TraceRecorder.h"
 //----------------------------------------------------------------------------------------------------------------------
 /// @brief the increment for x/y translation with mouse movement
 //----------------------------------------------------------------------------------------------------------------------
@@ -18,6 +19,19 @@ const static float INCREMENT = 0.05;
 /// @brief the increment for the wheel zoom
 //----------------------------------------------------------------------------------------------------------------------
 const static float ZOOM = .5;
+// frames between updates of the debug text
+const static unsigned int HUD_REFRESH_FRAMES = 15;
+// frames taken to cross-fade to the next clip
+const static unsigned int CLIP_FADE_FRAMES = 15;
+// instances drawn in crowd mode and the seconds the crowd moves on per timer tick
+const static unsigned int CROWD_SIZE = 100;
+const static float CROWD_FRAME_TIME = 0.02f;
+// crowd poses snap to the bake rate,so instances at the same frame of a clip share a pose and a skinned mesh
+const static float CROWD_POSE_STEP = 1.0f / 60;
+// vertical field of view of the camera in degrees,also used to measure the screen size of the meshes
+const static float CAMERA_FOV = 45;
+// reduced skeletons built for the meshes far from the camera
+const static unsigned int LOD_LEVELS = 3;
 //----------------------------------------------------------------------------------------------------------------------
 GLWindow::GLWindow(const QGLFormat _format, QWidget *_parent) : QGLWidget(_format, _parent)
 {
@@ -38,17 +52,30 @@ GLWindow::GLWindow(const QGLFormat _format, QWidget *_parent) : QGLWidget(_forma
 
   m_animate = false;
   m_frameTime = 0.0;
+  m_frame = 0;
+  m_fadeFromClip = 0;
+  m_fadeFrames = 0;
+  m_crowdMode = false;
+  m_lodEnabled = true;
+  // keep the last few minutes of timing spans,T saves them
+  TraceRecorder::instance()->setEnabled(true);
 
 
   m_deformMesh = new SkinDeformer();
   m_sceneData = new SceneLoader();
+  m_crowd = new SkinCrowd();
+  m_crowd->setPoseStep(CROWD_POSE_STEP);
+  m_crowd->setShareSkinned(true);
 
 }
 GLWindow::~GLWindow()
 {
   ngl::NGLInit *Init = ngl::NGLInit::instance();
   std::cout << "Shutting down NGL, removing VAO's and Shaders\n";
+  makeCurrent();
+  m_profiler.releaseGPU();
   Init->NGLQuit();
+  delete m_crowd;
   delete m_deformMesh;
   delete m_sceneData;
 }
@@ -69,7 +96,7 @@ void GLWindow::initializeGL()
   ngl::Vec3 up(0, 1, 0);
 
   m_camera = new ngl::Camera(eye, look, up);
-  m_camera->setShape(45, float(1024 / 720), 0.1, 300);
+  m_camera->setShape(CAMERA_FOV, float(1024 / 720), 0.1, 300);
 
 //create the shader
   ngl::ShaderLib *shader = ngl::ShaderLib::instance();
@@ -139,6 +166,7 @@ void GLWindow::initializeGL()
   m_text = new ngl::Text(QFont("Arial", 14));
   m_text->setScreenSize(width(), height());
 
+  m_profiler.initGPU();
   startTimer(20);
 }
 
@@ -148,16 +176,20 @@ void GLWindow::initializeGL()
 void GLWindow::resizeGL(int _w, int _h)
 {
   glViewport(0, 0, _w, _h);
-  m_camera->setShape(45, float(_w / _h), 0.1, 300);
+  m_camera->setShape(CAMERA_FOV, float(_w / _h), 0.1, 300);
 }
 
 
-void GLWindow::loadMatricesToShader()
+void GLWindow::loadMatricesToShader(const ngl::Vec3 &_offset)
 {
   ngl::Mat4 MV;
   ngl::Mat4 MVP;
   ngl::Mat4 M;
-  M = m_transformStack.getCurrentTransform().getMatrix() * m_mouseGlobalTX;
+  ngl::Mat4 offset;
+  offset.m_m[3][0] = _offset.m_x;
+  offset.m_m[3][1] = _offset.m_y;
+  offset.m_m[3][2] = _offset.m_z;
+  M = offset * m_transformStack.getCurrentTransform().getMatrix() * m_mouseGlobalTX;
   MV = M * m_camera->getViewMatrix();
   MVP = MV * m_camera->getProjectionMatrix() ;
 
@@ -187,15 +219,32 @@ void GLWindow::loadObj(std::string _p, std::string _o)
     texture.setTextureGL();
   }
   if (m_selectedObject != "") {
+    delete m_crowd;
     delete m_deformMesh;
     delete m_sceneData;
     m_boneTransfroms.clear();
     m_deformMesh = new SkinDeformer();
     m_sceneData = new SceneLoader();
+    m_crowd = new SkinCrowd();
+    m_crowd->setPoseStep(CROWD_POSE_STEP);
+    m_crowd->setShareSkinned(true);
   }
   // first we create a mesh from an obj passing in the obj file and texture
+  // the animation is baked into a clip sampled at 60 frames per second and each vertex keeps
+  // its 4 largest weights stored in 16 bits,with the vertices sorted by bone.these are the
+  // LBSkinBake defaults,so files baked offline load from the cache
+  m_sceneData->setBakeRate(60);
+  m_sceneData->setMaxInfluences(4);
+  m_sceneData->setWeightBits(16);
+  m_sceneData->setReorderVertices(true);
+  m_sceneData->setLodLevels(LOD_LEVELS);
   m_sceneData->load(meshPath);
+  m_fadeFrames = 0;
   m_deformMesh->setMeshData(m_sceneData);
+  if (m_crowdMode) {
+    m_crowd->setMeshData(m_sceneData);
+    m_crowd->layoutGrid(CROWD_SIZE);
+  }
   m_selectedObject = meshPath;
 }
 //----------------------------------------------------------------------------------------------------------------------
@@ -204,6 +253,8 @@ void GLWindow::loadObj(std::string _p, std::string _o)
 void GLWindow::paintGL()
 {
 
+  m_profiler.beginFrame();
+  traceScope trace("paintGL");
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   ngl::VAOPrimitives *prim = ngl::VAOPrimitives::instance();
   ngl::ShaderLib *shader = ngl::ShaderLib::instance();
@@ -229,14 +280,81 @@ void GLWindow::paintGL()
   shader->use("Surface");
   shader->setShaderParam3f("color", 0.2f, 0.2f, 0.2f);
   prim->draw("grid");
+  //the level of detail comes from how much of the screen the mesh covers
+  ngl::Mat4 modelView = m_transformStack.getCurrentTransform().getMatrix() * m_mouseGlobalTX * m_camera->getViewMatrix();
 
-  if (m_selectedObject != "") {
+  if (m_selectedObject != "" && m_crowdMode) {
+    if (m_animate) {
+      m_crowd->advance(CROWD_FRAME_TIME);
+      if (m_lodEnabled) {
+        m_crowd->selectLods(modelView, CAMERA_FOV);
+      }
+      {
+        profileScope scope(m_profiler, PROFILE_POSE);
+        m_crowd->updatePoses();
+      }
+      {
+        profileScope scope(m_profiler, PROFILE_SKIN);
+        m_crowd->deform();
+      }
+    }
+    {
+      profileScope scope(m_profiler, PROFILE_UPLOAD);
+      m_crowd->upload();
+    }
+    shader->use("Diffuse");
+    shader->setShaderParam3f("color", 0.5f, 0.5f, 1.0f);
+    {
+      traceScope drawTrace("draw");
+      m_profiler.begin(PROFILE_DRAW);
+      m_profiler.beginGPU();
+      //one shared VAO,only the model matrix and the vertex block change per instance
+      for (unsigned int i = 0; i < m_crowd->numInstances(); ++i) {
+        loadMatricesToShader(m_crowd->getInstance(i).m_position);
+        m_crowd->drawInstance(i);
+      }
+      m_profiler.endGPU();
+      m_profiler.end(PROFILE_DRAW);
+    }
+  } else if (m_selectedObject != "") {
 
     if (m_animate) {
       QTime t = QTime::currentTime();
       float time = float(t.msec() / 1000.0) * m_sceneData->getDuration() / m_sceneData->getTicksPerSec();
-      m_sceneData->boneTransform(time, m_boneTransfroms);
-      m_deformMesh->update();
+      unsigned int lod = 0, interval = 1;
+      if (m_lodEnabled) {
+        m_sceneData->selectLod(m_sceneData->screenSize(modelView, ngl::Vec3(0, 0, 0), CAMERA_FOV), lod, interval);
+      }
+      m_deformMesh->setLod(lod);
+      m_deformMesh->setUpdateInterval(interval);
+      //between updates the deformer interpolates and the skeleton is not needed
+      if (m_deformMesh->needsPose()) {
+        profileScope scope(m_profiler, PROFILE_POSE);
+        if (m_fadeFrames > 0) {
+          //blend from the previous clip to the current one in the same pose evaluation
+          std::vector<clipLayer> layers(2);
+          float fade = 1.0f - (float)m_fadeFrames / CLIP_FADE_FRAMES;
+          layers[0].m_clip = m_fadeFromClip;
+          layers[0].m_time = time;
+          layers[0].m_weight = 1.0f - fade;
+          layers[1].m_clip = m_sceneData->getCurrentClip();
+          layers[1].m_time = time;
+          layers[1].m_weight = fade;
+          m_sceneData->blendTransform(layers, m_boneTransfroms, lod);
+          --m_fadeFrames;
+        } else {
+          m_sceneData->boneTransform(time, m_boneTransfroms, lod);
+        }
+      }
+      {
+        profileScope scope(m_profiler, PROFILE_SKIN);
+        m_deformMesh->deform();
+      }
+      {
+        profileScope scope(m_profiler, PROFILE_UPLOAD);
+        m_deformMesh->prepareDraw();
+        m_deformMesh->upload();
+      }
       m_frameTime = time;
     }
 
@@ -244,19 +362,68 @@ void GLWindow::paintGL()
     loadMatricesToShader();
     shader->use("Diffuse");
     shader->setShaderParam3f("color", 0.5f, 0.5f, 1.0f);
-    m_deformMesh->drawDeformMesh();
+    {
+      traceScope drawTrace("draw");
+      m_profiler.begin(PROFILE_DRAW);
+      m_profiler.beginGPU();
+      m_deformMesh->drawDeformMesh();
+      m_profiler.endGPU();
+      m_profiler.end(PROFILE_DRAW);
+    }
 
   }
 
+  //the text is rebuilt a few times a second so the numbers can be read
+  if (m_frame % HUD_REFRESH_FRAMES == 0) {
+    updateHUD();
+  }
+  ++m_frame;
+
   if (m_debugDisplay == true) {
-    QString text;
     m_text->setColour(1, 1, 1);
-    text.sprintf("FPS ::");
-    m_text->renderText(10, 50, text);
+    for (unsigned int i = 0; i < m_hudLines.size(); ++i) {
+      m_text->renderText(10, 50 + 20 * i, m_hudLines[i]);
+    }
   }
 
 }
 
+void GLWindow::updateHUD()
+{
+  m_hudLines.clear();
+  float minMs, avgMs, p99Ms;
+  m_profiler.stats(PROFILE_FRAME, minMs, avgMs, p99Ms);
+  QString text;
+  text.sprintf("FPS :: %.1f", avgMs > 0 ? 1000.0f / avgMs : 0.0f);
+  m_hudLines.push_back(text);
+  if (m_sceneData->numClips() > 1) {
+    unsigned int clip = m_sceneData->getCurrentClip();
+    text.sprintf("clip %u/%u %s", clip + 1, m_sceneData->numClips(), m_sceneData->getClipName(clip).c_str());
+    m_hudLines.push_back(text);
+  }
+  if (m_crowdMode) {
+    text.sprintf("crowd %u shared %.1f MB per instance %.1f KB", m_crowd->numInstances(),
+                 m_crowd->sharedBytes() / (1024.0f * 1024.0f), m_crowd->instanceBytes() / 1024.0f);
+    m_hudLines.push_back(text);
+    text.sprintf("crowd poses evaluated %u meshes skinned %u", m_crowd->posesEvaluated(), m_crowd->meshesSkinned());
+    m_hudLines.push_back(text);
+  } else if (m_lodEnabled) {
+    unsigned int lod = m_deformMesh->getLod();
+    text.sprintf("lod %u/%u bones %u update every %u frames", lod, m_sceneData->numLods() - 1,
+                 m_sceneData->numLodBones(lod), m_deformMesh->getUpdateInterval());
+    m_hudLines.push_back(text);
+  }
+  //one line per stage,min/avg/p99 in milliseconds
+  for (int i = PROFILE_FRAME; i < PROFILE_NUM_STAGES; ++i) {
+    ProfileStage stage = (ProfileStage)i;
+    if (m_profiler.stats(stage, minMs, avgMs, p99Ms) == 0) {
+      continue;
+    }
+    text.sprintf("%-8s min %6.2f avg %6.2f p99 %6.2f ms", FrameProfiler::stageName(stage), minMs, avgMs, p99Ms);
+    m_hudLines.push_back(text);
+  }
+}
+
 void GLWindow::keyPressEvent(QKeyEvent *_event)
 {
   // this method is called every time the main window recives a key event.
@@ -275,6 +442,37 @@ void GLWindow::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_N : break;
   case Qt::Key_B :  break;
   case Qt::Key_P : break;
+    // cross-fade to the next clip
+  case Qt::Key_C :
+    if (m_sceneData->numClips() > 1) {
+      m_fadeFromClip = m_sceneData->getCurrentClip();
+      m_sceneData->setCurrentClip((m_fadeFromClip + 1) % m_sceneData->numClips());
+      m_fadeFrames = CLIP_FADE_FRAMES;
+    }
+    break;
+    // crowd mode,many copies of the mesh sharing its data
+  case Qt::Key_G :
+    m_crowdMode = !m_crowdMode;
+    if (m_crowdMode && m_selectedObject != "") {
+      //the old VAO is deleted here
+      makeCurrent();
+      m_crowd->setMeshData(m_sceneData);
+      m_crowd->layoutGrid(CROWD_SIZE);
+    }
+    break;
+    // level of detail by screen size ON/OFF
+  case Qt::Key_L :
+    m_lodEnabled = !m_lodEnabled;
+    if (!m_lodEnabled) {
+      m_crowd->resetLods();
+    }
+    break;
+    // save the recorded timing spans as a chrome trace
+  case Qt::Key_T :
+    if (TraceRecorder::instance()->writeChromeTrace("trace.json")) {
+      std::cout << "Saved trace.json\n";
+    }
+    break;
 
   default : break;
   }
@@ -390,6 +588,12 @@ void GLWindow::incrementFrame()
 {
   m_frameTime += (m_sceneData->getDuration() / m_sceneData->getTicksPerSec()) / 100;
   std::cout << "Frame Time=" << m_frameTime << std::endl;
+  //a stepped frame is the full skeleton skinned at once,not the level of detail and
+  //interpolated keys left by the last animated frame
+  m_deformMesh->setLod(0);
+  m_deformMesh->setUpdateInterval(1);
+  m_deformMesh->setLod(0);
+  m_deformMesh->setUpdateInterval(1);
   m_sceneData->boneTransform(m_frameTime, m_boneTransfroms);
   m_deformMesh->update();
 }
@@ -0,0 +1,144 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RigGenerator.cpp
+/// @brief member fucntions of class RigGenerator
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include "RigGenerator.h"
+#include<cmath>
+#include<algorithm>
+
+// the generated clips use the collada default
+const static double RIG_TICKS_PER_SECOND = 30.0;
+// radius of the tube,the bones are one unit long
+const static float RIG_RADIUS = 0.5f;
+// largest bend and twist of a bone in radians
+const static float RIG_BEND = 0.3f;
+const static float RIG_TWIST = 0.2f;
+
+RigGenerator::RigGenerator(const rigSettings &_settings)
+{
+  rigSettings settings = _settings;
+  settings.m_nBones = std::max(1u, settings.m_nBones);
+  settings.m_nInfluences = std::max(1u, std::min(settings.m_nInfluences, settings.m_nBones));
+  settings.m_length = settings.m_length > 0 ? settings.m_length : 1.0f;
+  settings.m_sampleRate = settings.m_sampleRate > 0 ? settings.m_sampleRate : 30.0f;
+  buildMesh(settings);
+  buildSkeleton(settings);
+}
+
+void RigGenerator::buildMesh(const rigSettings &_settings)
+{
+  //roughly square quads for the vertex count asked for
+  unsigned int nSegments = std::max(8u, (unsigned int)std::sqrt(_settings.m_nVerts / 4.0));
+  unsigned int nRings = std::max(2u, _settings.m_nVerts / nSegments);
+  float height = _settings.m_nBones;
+  unsigned int nBones = _settings.m_nBones;
+  unsigned int nInfluences = _settings.m_nInfluences;
+
+  m_vertData.resize(nRings * nSegments);
+  m_vertexBoneData.assign(nRings * nSegments, vertexBoneInfo());
+  for (unsigned int r = 0; r < nRings; ++r) {
+    float y = height * r / (nRings - 1);
+    //the bones either side of the closest one,kept inside the chain
+    int closest = std::min((int)y, (int)nBones - 1);
+    int first = std::max(0, std::min(closest - (int)(nInfluences - 1) / 2, (int)(nBones - nInfluences)));
+    std::vector<float> weights(nInfluences);
+    float total = 0;
+    for (unsigned int k = 0; k < nInfluences; ++k) {
+      float d = std::fabs(y - (first + k + 0.5f));
+      weights[k] = 1.0f / (1.0f + 4.0f * d * d);
+      total += weights[k];
+    }
+    for (unsigned int s = 0; s < nSegments; ++s) {
+      float angle = 2.0f * (float)M_PI * s / nSegments;
+      unsigned int index = r * nSegments + s;
+      vertData &v = m_vertData[index];
+      v.nx = std::cos(angle);
+      v.ny = 0;
+      v.nz = std::sin(angle);
+      v.x = RIG_RADIUS * v.nx;
+      v.y = y;
+      v.z = RIG_RADIUS * v.nz;
+      v.u = (float)s / nSegments;
+      v.v = (float)r / (nRings - 1);
+      for (unsigned int k = 0; k < nInfluences; ++k) {
+        m_vertexBoneData[index].addBoneData(first + k, weights[k] / total);
+      }
+    }
+  }
+
+  //two triangles per quad,the seam wraps round to the first segment
+  m_faces.clear();
+  m_faces.reserve((nRings - 1) * nSegments * 2);
+  for (unsigned int r = 0; r + 1 < nRings; ++r) {
+    for (unsigned int s = 0; s < nSegments; ++s) {
+      unsigned int a = r * nSegments + s;
+      unsigned int b = r * nSegments + (s + 1) % nSegments;
+      unsigned int c = a + nSegments;
+      unsigned int d = b + nSegments;
+      ngl::Face f;
+      f.m_numVerts = 3;
+      f.m_vert.resize(3);
+      f.m_vert[0] = a;
+      f.m_vert[1] = c;
+      f.m_vert[2] = b;
+      m_faces.push_back(f);
+      f.m_vert[0] = b;
+      f.m_vert[1] = c;
+      f.m_vert[2] = d;
+      m_faces.push_back(f);
+    }
+  }
+}
+
+void RigGenerator::buildSkeleton(const rigSettings &_settings)
+{
+  unsigned int nBones = _settings.m_nBones;
+  //bone i starts at y=i,the bind matrices are in the assimp order with the translation in the last column
+  m_boneData.resize(nBones);
+  for (unsigned int i = 0; i < nBones; ++i) {
+    boneInfo &bone = m_boneData[i];
+    bone.m_bindTransform = ngl::Mat4();
+    bone.m_bindTransform.m_13 = -(float)i;
+    bone.m_restPosition = ngl::Vec3(0, (float)i, 0);
+    bone.m_parentBoneId = (int)i - 1;
+    bone.m_nextBone = -1;
+    bone.m_finalTransform = ngl::Mat4();
+  }
+
+  //a root node that is not a bone followed by the chain,each bone one unit above its parent
+  m_nodeParents.assign(1, -1);
+  m_nodeBones.assign(1, -1);
+  m_nodeTracks.assign(1, -1);
+  m_nodeLocal.assign(1, ngl::Mat4());
+  for (unsigned int i = 0; i < nBones; ++i) {
+    m_nodeParents.push_back(i);
+    m_nodeBones.push_back(i);
+    m_nodeTracks.push_back(i);
+    ngl::Mat4 local;
+    local.m_13 = i == 0 ? 0.0f : 1.0f;
+    m_nodeLocal.push_back(local);
+  }
+
+  m_ticksPerSecond = RIG_TICKS_PER_SECOND;
+  m_duration = _settings.m_length * RIG_TICKS_PER_SECOND;
+  m_clip.begin(m_duration, _settings.m_sampleRate / RIG_TICKS_PER_SECOND, nBones);
+  unsigned int nFrames = m_clip.numFrames();
+  std::vector<ngl::Vec3> pos(nFrames), scale(nFrames, ngl::Vec3(1, 1, 1));
+  std::vector<ngl::Quaternion> rot(nFrames);
+  for (unsigned int i = 0; i < nBones; ++i) {
+    pos.assign(nFrames, ngl::Vec3(0, i == 0 ? 0.0f : 1.0f, 0));
+    for (unsigned int f = 0; f < nFrames; ++f) {
+      float phase = 2.0f * (float)M_PI * m_clip.frameTime(f) / m_duration;
+      float bend = RIG_BEND * std::sin(phase + 0.2f * i);
+      float twist = RIG_TWIST * std::sin(2.0f * phase + 0.1f * i);
+      //twist about y after a bend about z
+      float cz = std::cos(0.5f * bend), sz = std::sin(0.5f * bend);
+      float cy = std::cos(0.5f * twist), sy = std::sin(0.5f * twist);
+      rot[f] = ngl::Quaternion(cy * cz, sy * sz, sy * cz, cy * sz);
+    }
+    m_clip.setTrack(i, pos, rot, scale);
+  }
+}
@@ -11,6 +11,15 @@
 //----------------------------------------------------------------------------------------------------------------------
 #include "SceneLoader.h"
 #include"AIUtil.h"
+#include<algorithm>
+#include<sstream>
+#include"TraceRecorder.h"
+
+// smallest fraction of the screen height a mesh covers at each level of detail,with the frames
+// between its skeleton updates.the last row takes everything smaller
+const static unsigned int LOD_TABLE_SIZE = 4;
+const static float LOD_SCREEN_SIZE[LOD_TABLE_SIZE] = {0.3f, 0.15f, 0.06f, 0.0f};
+const static unsigned int LOD_UPDATE_INTERVAL[LOD_TABLE_SIZE] = {1, 2, 3, 4};
 
 bool SceneLoader::load(const std::string &_fname, bool _calcBB)
 {
@@ -24,12 +33,28 @@ bool SceneLoader::load(const std::string &_fname, bool _calcBB)
 //  aiAttachLogStream(&stream);
 #endif
 
-  m_scene = NULL;
+  //start from nothing so a second load does not add to the last one
+  clearScene();
+  //the cache holds the baked clip in place of the assimp channels so it needs a bake rate
+  uint64_t sourceHash = 0;
+  bool cached = m_useCache && m_bakeRate > 0 && AssetCache::hashFile(_fname, sourceHash);
+  if (cached) {
+    if (loadCache(cachePath(_fname), sourceHash)) {
+      m_cacheValid = true;
+      buildLods();
+      return true;
+    }
+    //a cache that failed part way has filled some of the members,the import starts clean
+    clearScene();
+  }
   //load the scene file
   m_scene = m_loader.ReadFile(_fname.c_str(),
                               aiProcessPreset_TargetRealtime_Quality |
                               aiProcess_Triangulate
                              );
+  if (m_scene == NULL) {
+    return false;
+  }
   m_rootNode = m_scene->mRootNode;
   m_globalInverse = AIU::aiMatrix4x4ToNGLMat4(m_scene->mRootNode->mTransformation);
   m_globalInverse.inverse();
@@ -38,169 +63,922 @@ bool SceneLoader::load(const std::string &_fname, bool _calcBB)
     loadPrimitives();
   }
 
+  //a static mesh still gets a node table and a packed table of empty influence lists
+  //so the deformers can index every vertex
+  loadBones();
   if (m_scene->HasAnimations()) {
-    m_numBones = 0;
-    loadBones();
+    m_duration = m_scene->mAnimations[0]->mDuration;
+    m_ticksPerSecond = m_scene->mAnimations[0]->mTicksPerSecond;
+    if (m_bakeRate > 0) {
+      bakeClips();
+      setCurrentClip(0);
+    }
   }
 
+  if (cached) {
+    m_cacheValid = saveCache(cachePath(_fname), sourceHash);
+  }
+  //the reduced skeletons are not cached,they are quick to build from the packed influences
+  buildLods();
   return true;
 }
 
-void SceneLoader::loadPrimitives()
+std::string SceneLoader::cachePath(const std::string &_fname) const
 {
-  vertData v;
-  const aiMesh *sceneMesh = m_scene->mMeshes[0];
-  //store the faces
-  for (int k = 0; k < sceneMesh->mNumFaces; ++k) {
+  //eg model.dae.r60_i4_w16_s1.lbcache
+  std::ostringstream settings;
+  settings << "r" << m_bakeRate << "_i" << m_maxInfluences << "_w" << m_weightBits << "_s" << (m_reorderVertices ? 1 : 0);
+  return AssetCache::cachePath(_fname, settings.str());
+}
+
+void SceneLoader::clearScene()
+{
+  m_scene = NULL;
+  m_useClip = false;
+  m_cacheValid = false;
+  m_clips.clear();
+  m_clipNames.clear();
+  m_clipTicksPerSecond.clear();
+  m_currentClip = 0;
+  m_lodInfluences.clear();
+  m_lodBones.clear();
+  m_vertData.clear();
+  m_tangents.clear();
+  m_face.clear();
+  m_nVerts = 0;
+  m_nFaces = 0;
+  m_meshes.clear();
+  m_boneData.clear();
+  m_boneMapping.clear();
+  m_meshBones.clear();
+  m_vertexBoneData.clear();
+  m_influences = skinInfluences();
+  m_nodes.clear();
+  m_nodeLocal.clear();
+  m_nodeGlobal.clear();
+  m_numBones = 0;
+  m_duration = 0;
+  m_ticksPerSecond = 0;
+}
+
+bool SceneLoader::saveCache(const std::string &_fname, uint64_t _sourceHash) const
+{
+  AssetCacheWriter cache(_sourceHash);
+  cache.writeValue(m_bakeRate);
+  cache.writeValue(m_maxInfluences);
+  cache.writeValue(m_weightBits);
+  cache.writeValue(m_reorderVertices);
+  //mesh
+  cache.writeArray(m_vertData);
+  cache.writeArray(m_tangents);
+  std::vector<unsigned int> faceSizes, faceVerts;
+  for (unsigned int i = 0; i < m_face.size(); ++i) {
+    faceSizes.push_back(m_face[i].m_numVerts);
+    for (unsigned int j = 0; j < m_face[i].m_numVerts; ++j) {
+      faceVerts.push_back(m_face[i].m_vert[j]);
+    }
+  }
+  cache.writeArray(faceSizes);
+  cache.writeArray(faceVerts);
+  cache.writeArray(m_meshes);
+  //skin
+  cache.writeValue(m_influences.m_nVerts);
+  cache.writeValue(m_influences.m_maxInfluences);
+  cache.writeValue(m_influences.m_idBytes);
+  cache.writeValue(m_influences.m_weightBytes);
+  cache.writeArray(m_influences.m_nInfluences);
+  cache.writeArray(m_influences.m_boneIds);
+  cache.writeArray(m_influences.m_weights);
+  //skeleton,the node channels are replaced by the clip tracks
+  cache.writeValue(m_numBones);
+  cache.writeValue(m_globalInverse);
+  cache.writeArray(m_boneData);
+  cache.writeArray(m_meshBones);
+  std::vector<int> nodeParents, nodeBones, nodeTracks;
+  for (unsigned int i = 0; i < m_nodes.size(); ++i) {
+    nodeParents.push_back(m_nodes[i].m_parent);
+    nodeBones.push_back(m_nodes[i].m_boneId);
+    nodeTracks.push_back(m_nodes[i].m_track);
+  }
+  cache.writeArray(nodeParents);
+  cache.writeArray(nodeBones);
+  cache.writeArray(nodeTracks);
+  cache.writeArray(m_nodeLocal);
+  //animation
+  cache.writeValue((unsigned int)m_clips.size());
+  for (unsigned int i = 0; i < m_clips.size(); ++i) {
+    cache.writeArray(std::vector<char>(m_clipNames[i].begin(), m_clipNames[i].end()));
+    cache.writeValue(m_clipTicksPerSecond[i]);
+    m_clips[i].write(cache);
+  }
+  return cache.save(_fname);
+}
+
+bool SceneLoader::loadCache(const std::string &_fname, uint64_t _sourceHash)
+{
+  AssetCacheReader cache;
+  if (!cache.open(_fname, _sourceHash)) {
+    return false;
+  }
+  //the cache is only valid for the settings it was baked with
+  float bakeRate = 0;
+  unsigned int maxInfluences = 0, weightBits = 0;
+  bool reorderVertices = false;
+  if (!cache.readValue(bakeRate) || bakeRate != m_bakeRate ||
+      !cache.readValue(maxInfluences) || maxInfluences != m_maxInfluences ||
+      !cache.readValue(weightBits) || weightBits != m_weightBits ||
+      !cache.readValue(reorderVertices) || reorderVertices != m_reorderVertices) {
+    return false;
+  }
+  //mesh
+  cache.readArray(m_vertData);
+  cache.readArray(m_tangents);
+  std::vector<unsigned int> faceSizes, faceVerts;
+  cache.readArray(faceSizes);
+  cache.readArray(faceVerts);
+  cache.readArray(m_meshes);
+  //skin
+  cache.readValue(m_influences.m_nVerts);
+  cache.readValue(m_influences.m_maxInfluences);
+  cache.readValue(m_influences.m_idBytes);
+  cache.readValue(m_influences.m_weightBytes);
+  cache.readArray(m_influences.m_nInfluences);
+  cache.readArray(m_influences.m_boneIds);
+  cache.readArray(m_influences.m_weights);
+  //skeleton
+  cache.readValue(m_numBones);
+  cache.readValue(m_globalInverse);
+  cache.readArray(m_boneData);
+  cache.readArray(m_meshBones);
+  std::vector<int> nodeParents, nodeBones, nodeTracks;
+  cache.readArray(nodeParents);
+  cache.readArray(nodeBones);
+  cache.readArray(nodeTracks);
+  cache.readArray(m_nodeLocal);
+  //animation
+  unsigned int nClips = 0;
+  bool clipRead = cache.readValue(nClips);
+  m_clips.resize(nClips);
+  m_clipNames.resize(nClips);
+  m_clipTicksPerSecond.resize(nClips);
+  for (unsigned int i = 0; i < nClips && clipRead; ++i) {
+    std::vector<char> name;
+    cache.readArray(name);
+    m_clipNames[i].assign(name.begin(), name.end());
+    cache.readValue(m_clipTicksPerSecond[i]);
+    clipRead = m_clips[i].read(cache);
+  }
+  size_t nSlots = (size_t)m_influences.m_nVerts * m_influences.m_maxInfluences;
+  if (cache.failed() || !clipRead ||
+      m_influences.m_boneIds.size() != nSlots * m_influences.m_idBytes ||
+      m_influences.m_weights.size() != nSlots * m_influences.m_weightBytes ||
+      (!m_meshBones.empty() && m_meshBones.size() != m_meshes.size() * m_numBones) ||
+      nodeBones.size() != nodeParents.size() || nodeTracks.size() != nodeParents.size() ||
+      m_nodeLocal.size() != nodeParents.size()) {
+    return false;
+  }
+
+  m_face.clear();
+  unsigned int next = 0;
+  for (unsigned int i = 0; i < faceSizes.size(); ++i) {
     ngl::Face f;
-    const aiFace face = sceneMesh->mFaces[k];
-    f.m_numVerts = face.mNumIndices;
-    for (int j = 0; j < f.m_numVerts; ++j) {
-      f.m_vert.push_back(face.mIndices[j]);
+    f.m_numVerts = faceSizes[i];
+    for (unsigned int j = 0; j < f.m_numVerts && next < faceVerts.size(); ++j) {
+      f.m_vert.push_back(faceVerts[next++]);
     }
     m_face.push_back(f);
   }
+  m_nFaces = m_face.size();
+  m_nVerts = m_vertData.size();
+  m_vertexBoneData.clear();
 
-  m_nFaces = sceneMesh->mNumFaces;
-  //store the vertices
-  for (int k = 0; k < sceneMesh->mNumVertices; ++k) {
-    //normals
-    if (sceneMesh->mNormals != NULL) {
-      v.nx = sceneMesh->mNormals[k].x;
-      v.ny = sceneMesh->mNormals[k].y;
-      v.nz = sceneMesh->mNormals[k].z;
+  setClipNodes(nodeParents, nodeBones, nodeTracks);
+  setCurrentClip(0);
+  return true;
+}
+
+void SceneLoader::setClipNodes(const std::vector<int> &_parents, const std::vector<int> &_bones, const std::vector<int> &_tracks)
+{
+  m_nodes.resize(_parents.size());
+  for (unsigned int i = 0; i < m_nodes.size(); ++i) {
+    m_nodes[i].m_parent = _parents[i];
+    m_nodes[i].m_channel = NULL;
+    m_nodes[i].m_boneId = _bones[i];
+    m_nodes[i].m_track = _tracks[i];
+    m_nodes[i].m_lastLod = 0;
+    m_nodes[i].m_cursor = keyCursor();
+  }
+  m_nodeGlobal.resize(m_nodes.size());
+  m_useClip = true;
+}
+
+void SceneLoader::loadRig(const rigSettings &_settings)
+{
+  m_scene = NULL;
+  m_cacheValid = false;
+  RigGenerator rig(_settings);
+  //take the generated data over rather than copying it,a large rig is hundreds of megabytes
+  m_vertData.swap(rig.m_vertData);
+  m_tangents.clear();
+  m_face.swap(rig.m_faces);
+  m_nFaces = m_face.size();
+  m_nVerts = m_vertData.size();
+  meshRange range;
+  range.m_sourceMesh = 0;
+  range.m_firstVert = 0;
+  range.m_nVerts = m_nVerts;
+  range.m_firstFace = 0;
+  range.m_nFaces = m_nFaces;
+  m_meshes.assign(1, range);
+  m_vertexBoneData.swap(rig.m_vertexBoneData);
+  packInfluences();
+  m_boneData.swap(rig.m_boneData);
+  m_numBones = m_boneData.size();
+  m_boneMapping.clear();
+  m_meshBones.clear();
+  m_globalInverse = ngl::Mat4();
+  m_nodeLocal.swap(rig.m_nodeLocal);
+  m_clips.assign(1, rig.m_clip);
+  m_clipNames.assign(1, "rig");
+  m_clipTicksPerSecond.assign(1, rig.m_ticksPerSecond);
+  setClipNodes(rig.m_nodeParents, rig.m_nodeBones, rig.m_nodeTracks);
+  setCurrentClip(0);
+  buildLods();
+}
+
+void SceneLoader::loadPrimitives()
+{
+  //take the skinned meshes,a file without bones keeps all of its meshes as before
+  std::vector<unsigned int> meshes;
+  for (unsigned int m = 0; m < m_scene->mNumMeshes; ++m) {
+    if (m_scene->mMeshes[m]->HasBones()) {
+      meshes.push_back(m);
+    }
+  }
+  if (meshes.empty()) {
+    for (unsigned int m = 0; m < m_scene->mNumMeshes; ++m) {
+      meshes.push_back(m);
     }
-    //uvs
-    if (sceneMesh->mTextureCoords != NULL && sceneMesh->HasTextureCoords(0)) {
-      v.u = sceneMesh->mTextureCoords[0]->x;
-      v.v = sceneMesh->mTextureCoords[0]->y;
+  }
+  //the tangent array has to cover every vertex if any mesh has tangents
+  bool hasTangents = false;
+  for (unsigned int m = 0; m < meshes.size(); ++m) {
+    hasTangents |= m_scene->mMeshes[meshes[m]]->HasTangentsAndBitangents();
+  }
+
+  m_meshes.clear();
+  vertData v;
+  for (unsigned int m = 0; m < meshes.size(); ++m) {
+    const aiMesh *sceneMesh = m_scene->mMeshes[meshes[m]];
+    meshRange range;
+    range.m_sourceMesh = meshes[m];
+    range.m_firstVert = m_vertData.size();
+    range.m_nVerts = sceneMesh->mNumVertices;
+    range.m_firstFace = m_face.size();
+    range.m_nFaces = sceneMesh->mNumFaces;
+    m_meshes.push_back(range);
+    //store the faces,the indices are offset to the combined vertex list
+    for (int k = 0; k < sceneMesh->mNumFaces; ++k) {
+      ngl::Face f;
+      const aiFace face = sceneMesh->mFaces[k];
+      f.m_numVerts = face.mNumIndices;
+      for (int j = 0; j < f.m_numVerts; ++j) {
+        f.m_vert.push_back(range.m_firstVert + face.mIndices[j]);
+      }
+      m_face.push_back(f);
+    }
+
+    //store the vertices
+    for (int k = 0; k < sceneMesh->mNumVertices; ++k) {
+      //normals
+      if (sceneMesh->mNormals != NULL) {
+        v.nx = sceneMesh->mNormals[k].x;
+        v.ny = sceneMesh->mNormals[k].y;
+        v.nz = sceneMesh->mNormals[k].z;
+      }
+      //uvs
+      if (sceneMesh->mTextureCoords != NULL && sceneMesh->HasTextureCoords(0)) {
+        v.u = sceneMesh->mTextureCoords[0][k].x;
+        v.v = sceneMesh->mTextureCoords[0][k].y;
+      }
+      //position
+      v.x = sceneMesh->mVertices[k].x;
+      v.y = sceneMesh->mVertices[k].y;
+      v.z = sceneMesh->mVertices[k].z;
+      m_vertData.push_back(v);
+      //tangents for normal mapping,generated by the importer preset
+      if (sceneMesh->HasTangentsAndBitangents()) {
+        m_tangents.push_back(AIU::aiVector3DToNGLVec3(sceneMesh->mTangents[k]));
+      } else if (hasTangents) {
+        m_tangents.push_back(ngl::Vec3(0, 0, 0));
+      }
     }
-    //position
-    v.x = sceneMesh->mVertices[k].x;
-    v.y = sceneMesh->mVertices[k].y;
-    v.z = sceneMesh->mVertices[k].z;
-    m_vertData.push_back(v);
   }
-  m_nVerts = sceneMesh->mNumVertices;
+  m_nFaces = m_face.size();
+  m_nVerts = m_vertData.size();
   m_vertexBoneData.resize(m_nVerts);
 }
 
+// true if two bind matrices are the same,a shared bone keeps one entry per distinct bind pose
+static bool sameTransform(const ngl::Mat4 &_a, const ngl::Mat4 &_b)
+{
+  return std::equal(_a.m_openGL, _a.m_openGL + 16, _b.m_openGL);
+}
+
+int SceneLoader::boneEntry(int _first, const ngl::Mat4 &_bindTransform, int _parent)
+{
+  int last = -1;
+  for (int b = _first ; b >= 0 ; b = m_boneData[b].m_nextBone) {
+    if (sameTransform(m_boneData[b].m_bindTransform, _bindTransform)) {
+      return b;
+    }
+    last = b;
+  }
+  // Allocate an index for a new bone or bind pose
+  int BoneIndex = m_numBones;
+  m_numBones++;
+  boneInfo bi;
+  bi.m_bindTransform = _bindTransform;
+  //since the inverse matrix is passed ,the rest position will need to be inverted
+  //instead of doing a costly invert matrix ,the position is multiplied by -1
+  bi.m_restPosition = -ngl::Vec3(bi.m_bindTransform.m_03,
+                                 bi.m_bindTransform.m_13,
+                                 bi.m_bindTransform.m_23);
+
+  bi.m_parentBoneId = _parent;
+  bi.m_nextBone = -1;
+  if (last >= 0) {
+    m_boneData[last].m_nextBone = BoneIndex;
+  }
+  m_boneData.push_back(bi);
+  return BoneIndex;
+}
+
 void SceneLoader::loadBones()
 {
-  unsigned int n = m_scene->mMeshes[0]->mNumBones;
-//first pass to build and store the bonedata without parent information
-  for (unsigned int i = 0 ; i < n ; ++i) {
-    aiBone *bone = m_scene->mMeshes[0]->mBones[i];
-    unsigned int BoneIndex = 0;
-    std::string boneName(bone->mName.data);
-    if (m_boneMapping.find(boneName) == m_boneMapping.end()) {
-      // Allocate an index for a new bone
-      BoneIndex = m_numBones;
-      m_numBones++;
-      boneInfo bi;
-      bi.m_bindTransform = AIU::aiMatrix4x4ToNGLMat4(bone->mOffsetMatrix);
-      //since the inverse matrix is passed ,the rest position will need to be inverted
-      //instead of doing a costly invert matrix ,the position is multiplied by -1
-      bi.m_restPosition = -ngl::Vec3(bi.m_bindTransform.m_03,
-                                     bi.m_bindTransform.m_13,
-                                     bi.m_bindTransform.m_23);
-
-      bi.m_parentBoneId = -1;
+//first pass to build and store the bonedata without parent information,
+//a bone used by several meshes is evaluated once but gets an entry for each distinct offset matrix
+//so every mesh keeps its own bind pose,m_boneMapping holds the first entry of each bone
+  std::vector<std::map<int, int> > meshBones(m_meshes.size());
+  for (unsigned int m = 0 ; m < m_meshes.size() ; ++m) {
+    const aiMesh *sceneMesh = m_scene->mMeshes[m_meshes[m].m_sourceMesh];
+    for (unsigned int i = 0 ; i < sceneMesh->mNumBones ; ++i) {
+      aiBone *bone = sceneMesh->mBones[i];
+      std::string boneName(bone->mName.data);
       // this is the Matrix that transforms from mesh space to bone space in bind pose.
-      m_boneMapping[boneName] = BoneIndex;
-      m_boneData.push_back(bi);
-    } else {
-      BoneIndex = m_boneMapping[boneName];
-    }
-    for (unsigned int j = 0 ; j < bone->mNumWeights ; ++j) {
-      unsigned int VertexID = bone->mWeights[j].mVertexId;
-      float Weight  = bone->mWeights[j].mWeight;
-      m_vertexBoneData[VertexID].addBoneData(BoneIndex, Weight);
+      ngl::Mat4 bindTransform = AIU::aiMatrix4x4ToNGLMat4(bone->mOffsetMatrix);
+      std::map<std::string, unsigned int>::const_iterator found = m_boneMapping.find(boneName);
+      int BoneIndex;
+      if (found != m_boneMapping.end()) {
+        BoneIndex = boneEntry(found->second, bindTransform, -1);
+      } else {
+        BoneIndex = boneEntry(-1, bindTransform, -1);
+        m_boneMapping[boneName] = BoneIndex;
+      }
+      meshBones[m][m_boneMapping[boneName]] = BoneIndex;
+      for (unsigned int j = 0 ; j < bone->mNumWeights ; ++j) {
+        unsigned int VertexID = m_meshes[m].m_firstVert + bone->mWeights[j].mVertexId;
+        float Weight  = bone->mWeights[j].mWeight;
+        m_vertexBoneData[VertexID].addBoneData(BoneIndex, Weight);
+      }
     }
   }
-//second pass to build the bone parent relationship
-  for (unsigned int i = 0 ; i < n ; ++i) {
-    aiBone *bone = m_scene->mMeshes[0]->mBones[i];
-    std::string boneName(bone->mName.data);
-    unsigned int BoneIndex = m_boneMapping[boneName];
-    const aiNode* boneNode = m_rootNode->FindNode(boneName.c_str());
-
+//second pass to build the bone parent relationship,every entry of a bone points at the first
+//entry of its parent
+  for (std::map<std::string, unsigned int>::const_iterator bone = m_boneMapping.begin() ; bone != m_boneMapping.end() ; ++bone) {
+    const aiNode* boneNode = m_rootNode->FindNode(bone->first.c_str());
+    if (boneNode == NULL || boneNode->mParent == NULL) {
+      continue;
+    }
     std::string parentBoneName(boneNode->mParent->mName.data);
     if (m_boneMapping.find(parentBoneName) != m_boneMapping.end()) {
       unsigned int parentBoneIndex = m_boneMapping[parentBoneName];
-      m_boneData[BoneIndex].m_parentBoneId = parentBoneIndex;
+      for (int b = bone->second ; b >= 0 ; b = m_boneData[b].m_nextBone) {
+        m_boneData[b].m_parentBoneId = parentBoneIndex;
+      }
+    }
+  }
+//third pass,the reduced skeletons move the weights of a bone to its ancestors so every mesh needs
+//its bind pose of each ancestor of its bones.a missing one is derived from a mesh with both bones,
+//two meshes' offsets of any bone differ by the same mesh transform:
+//offset_m(parent) = offset_a(parent) * inverse(offset_a(child)) * offset_m(child)
+  for (unsigned int m = 0 ; m < meshBones.size() ; ++m) {
+    std::vector<int> used;
+    for (std::map<int, int>::const_iterator b = meshBones[m].begin() ; b != meshBones[m].end() ; ++b) {
+      used.push_back(b->first);
+    }
+    for (unsigned int i = 0 ; i < used.size() ; ++i) {
+      int child = used[i];
+      int parent = m_boneData[child].m_parentBoneId;
+      while (parent >= 0 && meshBones[m].find(parent) == meshBones[m].end()) {
+        int entry = parent;
+        int childEntry = meshBones[m][child];
+        for (unsigned int a = 0 ; a < meshBones.size() ; ++a) {
+          std::map<int, int>::const_iterator aParent = meshBones[a].find(parent);
+          std::map<int, int>::const_iterator aChild = meshBones[a].find(child);
+          if (a == m || aParent == meshBones[a].end() || aChild == meshBones[a].end()) {
+            continue;
+          }
+          entry = aParent->second;
+          if (aChild->second != childEntry) {
+            ngl::Mat4 childInverse = m_boneData[aChild->second].m_bindTransform;
+            childInverse.inverse();
+            ngl::Mat4 bindTransform = m_boneData[entry].m_bindTransform * childInverse * m_boneData[childEntry].m_bindTransform;
+            entry = boneEntry(parent, bindTransform, m_boneData[parent].m_parentBoneId);
+          }
+          break;
+        }
+        meshBones[m][parent] = entry;
+        child = parent;
+        parent = m_boneData[parent].m_parentBoneId;
+      }
+    }
+  }
+  m_meshBones.assign(m_meshes.size() * m_numBones, -1);
+  for (unsigned int m = 0 ; m < meshBones.size() ; ++m) {
+    for (std::map<int, int>::const_iterator b = meshBones[m].begin() ; b != meshBones[m].end() ; ++b) {
+      m_meshBones[m * m_numBones + b->first] = b->second;
+    }
+  }
+//pack the influences once so the deformers do not copy the per vertex lists every frame
+  packInfluences();
+//resolve the animation channel and bone of every node once instead of every frame
+  m_nodes.clear();
+  m_nodeLocal.clear();
+  buildNodeTable(m_rootNode, -1);
+  m_nodeGlobal.resize(m_nodes.size());
+}
+
+void SceneLoader::packInfluences()
+{
+  //limit the bones per vertex before packing,the packed table is as wide as the largest vertex
+  for (unsigned int i = 0 ; i < m_vertexBoneData.size() ; ++i) {
+    m_vertexBoneData[i].limitInfluences(m_maxInfluences);
+  }
+  if (m_reorderVertices) {
+    reorderVertices();
+  }
+  m_influences.build(m_vertexBoneData, m_weightBits);
+}
+
+void SceneLoader::reorderVertices()
+{
+  unsigned int nVerts = m_vertData.size();
+  if (m_vertexBoneData.size() != nVerts) {
+    return;
+  }
+  //dominant bone in the first slot and the rest by id,sorting on the id lists then groups vertices
+  //by dominant bone and puts vertices with the same bones next to each other with matching slots
+  for (unsigned int i = 0 ; i < nVerts ; ++i) {
+    m_vertexBoneData[i].sortInfluences();
+  }
+  //order[new]=old,the stable sort keeps the file order inside a run of identical bone sets
+  std::vector<unsigned int> order(nVerts);
+  for (unsigned int i = 0 ; i < nVerts ; ++i) {
+    order[i] = i;
+  }
+  //each mesh is sorted on its own so the mesh ranges stay valid
+  const std::vector<vertexBoneInfo> &bones = m_vertexBoneData;
+  for (unsigned int m = 0 ; m < m_meshes.size() ; ++m) {
+    std::vector<unsigned int>::iterator first = order.begin() + m_meshes[m].m_firstVert;
+    std::stable_sort(first, first + m_meshes[m].m_nVerts, [&bones](unsigned int _a, unsigned int _b)
+    {
+      return bones[_a].m_boneIds < bones[_b].m_boneIds;
+    });
+  }
+
+  std::vector<unsigned int> remap(nVerts);
+  std::vector<vertData> vertices(nVerts);
+  std::vector<vertexBoneInfo> influences(nVerts);
+  bool hasTangents = m_tangents.size() == nVerts;
+  std::vector<ngl::Vec3> tangents(hasTangents ? nVerts : 0);
+  for (unsigned int i = 0 ; i < nVerts ; ++i) {
+    remap[order[i]] = i;
+    vertices[i] = m_vertData[order[i]];
+    influences[i].m_nWeights = m_vertexBoneData[order[i]].m_nWeights;
+    influences[i].m_boneIds.swap(m_vertexBoneData[order[i]].m_boneIds);
+    influences[i].m_skinWeights.swap(m_vertexBoneData[order[i]].m_skinWeights);
+    if (hasTangents) {
+      tangents[i] = m_tangents[order[i]];
+    }
+  }
+  m_vertData.swap(vertices);
+  m_vertexBoneData.swap(influences);
+  if (hasTangents) {
+    m_tangents.swap(tangents);
+  }
+  for (unsigned int i = 0 ; i < m_face.size() ; ++i) {
+    for (unsigned int j = 0 ; j < m_face[i].m_vert.size() ; ++j) {
+      m_face[i].m_vert[j] = remap[m_face[i].m_vert[j]];
+    }
+  }
+}
+
+void SceneLoader::buildLods()
+{
+  traceScope trace("buildLods");
+  //a sphere round the bounding box of the bind pose
+  ngl::Vec3 low(0, 0, 0), high(0, 0, 0);
+  for (unsigned int i = 0 ; i < m_vertData.size() ; ++i) {
+    ngl::Vec3 p(m_vertData[i].x, m_vertData[i].y, m_vertData[i].z);
+    if (i == 0) {
+      low = high = p;
+    }
+    low = ngl::Vec3(std::min(low.m_x, p.m_x), std::min(low.m_y, p.m_y), std::min(low.m_z, p.m_z));
+    high = ngl::Vec3(std::max(high.m_x, p.m_x), std::max(high.m_y, p.m_y), std::max(high.m_z, p.m_z));
+  }
+  m_boundCentre = (low + high) * 0.5f;
+  m_boundRadius = (high - low).length() * 0.5f;
+
+  m_lodInfluences.clear();
+  m_lodBones.assign(1, m_numBones);
+  for (unsigned int i = 0 ; i < m_nodes.size() ; ++i) {
+    m_nodes[i].m_lastLod = 0;
+  }
+  if (m_lodLevels == 0 || m_numBones == 0 || m_influences.m_nVerts == 0) {
+    return;
+  }
+  //the parent of a bone is its nearest ancestor node that is a bone,a bone without a node is never merged.
+  //the extra bind pose entries of a shared bone follow the first entry of their node
+  std::vector<int> parentBone(m_numBones, -1);
+  std::vector<int> firstBone(m_numBones);
+  std::vector<bool> hasNode(m_numBones, false);
+  for (unsigned int b = 0 ; b < m_numBones ; ++b) {
+    firstBone[b] = b;
+  }
+  for (unsigned int i = 0 ; i < m_nodes.size() ; ++i) {
+    int bone = m_nodes[i].m_boneId;
+    if (bone < 0 || bone >= (int)m_numBones) {
+      continue;
+    }
+    int parent = m_nodes[i].m_parent;
+    while (parent >= 0 && m_nodes[parent].m_boneId < 0) {
+      parent = m_nodes[parent].m_parent;
+    }
+    for (int b = bone ; b >= 0 ; b = m_boneData[b].m_nextBone) {
+      parentBone[b] = parent >= 0 ? m_nodes[parent].m_boneId : -1;
+      firstBone[b] = bone;
+      hasNode[b] = true;
+    }
+  }
+  std::vector<bool> kept(m_numBones, true);
+  for (unsigned int level = 1 ; level <= m_lodLevels ; ++level) {
+    //the leaves are the kept bones without kept children,the roots have nowhere to go and stay
+    std::vector<bool> hasChild(m_numBones, false);
+    for (unsigned int b = 0 ; b < m_numBones ; ++b) {
+      if (kept[b] && parentBone[b] >= 0) {
+        hasChild[parentBone[b]] = true;
+      }
+    }
+    unsigned int nMerged = 0;
+    for (unsigned int b = 0 ; b < m_numBones ; ++b) {
+      if (firstBone[b] == (int)b && kept[b] && !hasChild[b] && parentBone[b] >= 0 && hasNode[b]) {
+        kept[b] = false;
+        ++nMerged;
+      }
+    }
+    if (nMerged == 0) {
+      break;
+    }
+    //every bone moves to the first entry of its nearest kept ancestor
+    std::vector<unsigned int> remap(m_numBones);
+    unsigned int nKept = 0;
+    for (unsigned int b = 0 ; b < m_numBones ; ++b) {
+      kept[b] = kept[firstBone[b]];
+      int target = b;
+      while (!kept[target]) {
+        target = parentBone[target];
+      }
+      remap[b] = target;
+      nKept += kept[b] ? 1 : 0;
+    }
+    //a node is evaluated at this level if a kept bone is at or below it,children come after
+    //their parents so walking the table backwards sees every child first
+    std::vector<bool> needed(m_nodes.size(), false);
+    for (int i = (int)m_nodes.size() - 1 ; i >= 0 ; --i) {
+      int bone = m_nodes[i].m_boneId;
+      if (bone >= 0 && bone < (int)m_numBones && kept[bone]) {
+        needed[i] = true;
+      }
+      if (needed[i]) {
+        m_nodes[i].m_lastLod = level;
+        if (m_nodes[i].m_parent >= 0) {
+          needed[m_nodes[i].m_parent] = true;
+        }
+      }
+    }
+    //weights of merged bones are added to the bone they moved to,in the entry with the bind pose
+    //of the vertex's mesh
+    std::vector<vertexBoneInfo> data(m_influences.m_nVerts);
+    bool meshBones = m_meshBones.size() == m_meshes.size() * m_numBones;
+    unsigned int mesh = 0;
+    for (unsigned int v = 0 ; v < m_influences.m_nVerts ; ++v) {
+      while (mesh + 1 < m_meshes.size() && v >= m_meshes[mesh].m_firstVert + m_meshes[mesh].m_nVerts) {
+        ++mesh;
+      }
+      vertexBoneInfo &info = data[v];
+      for (unsigned int j = 0 ; j < m_influences.count(v) ; ++j) {
+        unsigned int id = m_influences.boneId(v, j);
+        unsigned int bone = remap[id];
+        if (bone != id && meshBones && m_meshBones[mesh * m_numBones + bone] >= 0) {
+          bone = m_meshBones[mesh * m_numBones + bone];
+        }
+        ngl::Real weight = m_influences.weight(v, j);
+        int k = 0;
+        while (k < info.m_nWeights && info.m_boneIds[k] != (int)bone) {
+          ++k;
+        }
+        if (k < info.m_nWeights) {
+          info.m_skinWeights[k] += weight;
+        } else {
+          info.addBoneData(bone, weight);
+        }
+      }
+      if (m_reorderVertices) {
+        info.sortInfluences();
+      }
+    }
+    m_lodInfluences.push_back(skinInfluences());
+    m_lodInfluences.back().build(data, m_weightBits);
+    m_lodBones.push_back(nKept);
+  }
+}
+
+const skinInfluences &SceneLoader::getInfluences(unsigned int _lod) const
+{
+  if (_lod == 0 || m_lodInfluences.empty()) {
+    return m_influences;
+  }
+  return m_lodInfluences[std::min(_lod, (unsigned int)m_lodInfluences.size()) - 1];
+}
+
+unsigned int SceneLoader::numLodBones(unsigned int _lod) const
+{
+  if (m_lodBones.empty()) {
+    return m_numBones;
+  }
+  return m_lodBones[std::min(_lod, (unsigned int)m_lodBones.size() - 1)];
+}
+
+float SceneLoader::screenSize(const ngl::Mat4 &_modelView, const ngl::Vec3 &_offset, float _fovY) const
+{
+  //centre of the bounds in view space,the matrices take row vectors with the translation in the last row
+  ngl::Vec3 c = m_boundCentre + _offset;
+  ngl::Vec3 view(c.m_x * _modelView.m_m[0][0] + c.m_y * _modelView.m_m[1][0] + c.m_z * _modelView.m_m[2][0] + _modelView.m_m[3][0],
+                 c.m_x * _modelView.m_m[0][1] + c.m_y * _modelView.m_m[1][1] + c.m_z * _modelView.m_m[2][1] + _modelView.m_m[3][1],
+                 c.m_x * _modelView.m_m[0][2] + c.m_y * _modelView.m_m[1][2] + c.m_z * _modelView.m_m[2][2] + _modelView.m_m[3][2]);
+  float distance = view.length();
+  float halfHeight = distance * tanf(_fovY * (float)M_PI / 360.0f);
+  if (distance <= m_boundRadius || halfHeight <= 0) {
+    return 1.0f;
+  }
+  return std::min(1.0f, m_boundRadius / halfHeight);
+}
+
+void SceneLoader::selectLod(float _screenSize, unsigned int &o_lod, unsigned int &o_interval) const
+{
+  unsigned int row = 0;
+  while (row < LOD_TABLE_SIZE - 1 && _screenSize < LOD_SCREEN_SIZE[row]) {
+    ++row;
+  }
+  o_lod = std::min(row, numLods() - 1);
+  o_interval = LOD_UPDATE_INTERVAL[row];
+}
+
+void SceneLoader::buildNodeTable(const aiNode* _node, int _parent)
+{
+  std::string name(_node->mName.data);
+  animNode n;
+  n.m_parent = _parent;
+  n.m_channel = m_scene->HasAnimations() ? findNodeAnim(m_scene->mAnimations[0], name) : NULL;
+  std::map<std::string, unsigned int>::const_iterator bone = m_boneMapping.find(name);
+  n.m_boneId = bone != m_boneMapping.end() ? (int)bone->second : -1;
+  n.m_track = -1;
+  n.m_lastLod = 0;
+  int index = m_nodes.size();
+  m_nodes.push_back(n);
+  m_nodeLocal.push_back(AIU::aiMatrix4x4ToNGLMat4(_node->mTransformation));
+  for (unsigned int i = 0 ; i < _node->mNumChildren ; ++i) {
+    buildNodeTable(_node->mChildren[i], index);
+  }
+}
+
+// the assimp nodes in the order buildNodeTable() stores them
+static void collectNodes(const aiNode *_node, std::vector<const aiNode *> &io_nodes)
+{
+  io_nodes.push_back(_node);
+  for (unsigned int i = 0 ; i < _node->mNumChildren ; ++i) {
+    collectNodes(_node->mChildren[i], io_nodes);
+  }
+}
+
+void SceneLoader::bakeClips()
+{
+  std::vector<const aiNode *> sourceNodes;
+  collectNodes(m_rootNode, sourceNodes);
+  //a node animated by any animation gets a track in every clip so a node reads the same
+  //track whichever clips are blended
+  std::vector<std::vector<const aiNodeAnim *> > channels(m_scene->mNumAnimations);
+  unsigned int nTracks = 0;
+  for (unsigned int i = 0 ; i < m_nodes.size() ; ++i) {
+    std::string name(sourceNodes[i]->mName.data);
+    bool animated = false;
+    for (unsigned int a = 0 ; a < m_scene->mNumAnimations ; ++a) {
+      channels[a].push_back(findNodeAnim(m_scene->mAnimations[a], name));
+      animated |= channels[a].back() != NULL;
     }
+    m_nodes[i].m_track = animated ? nTracks++ : -1;
+  }
 
+  m_clips.resize(m_scene->mNumAnimations);
+  m_clipNames.resize(m_scene->mNumAnimations);
+  m_clipTicksPerSecond.resize(m_scene->mNumAnimations);
+  for (unsigned int a = 0 ; a < m_scene->mNumAnimations ; ++a) {
+    const aiAnimation *anim = m_scene->mAnimations[a];
+    float ticksPerSecond = anim->mTicksPerSecond != 0 ? anim->mTicksPerSecond : 25.0f;
+    m_clipNames[a] = anim->mName.data;
+    m_clipTicksPerSecond[a] = anim->mTicksPerSecond;
+    AnimClip &clip = m_clips[a];
+    clip.begin(anim->mDuration, m_bakeRate / ticksPerSecond, nTracks);
+    unsigned int nFrames = clip.numFrames();
+    std::vector<ngl::Vec3> pos(nFrames), scale(nFrames);
+    std::vector<ngl::Quaternion> rot(nFrames);
+    for (unsigned int i = 0 ; i < m_nodes.size() ; ++i) {
+      if (m_nodes[i].m_track < 0) {
+        continue;
+      }
+      const aiNodeAnim *channel = channels[a][i];
+      if (channel == NULL) {
+        //not animated by this clip,hold the node transform of the file which is stored once
+        aiVector3D restScale, restPos;
+        aiQuaternion restRot;
+        sourceNodes[i]->mTransformation.Decompose(restScale, restRot, restPos);
+        pos.assign(nFrames, AIU::aiVector3DToNGLVec3(restPos));
+        rot.assign(nFrames, AIU::aiQuatToNGLQuat(restRot));
+        scale.assign(nFrames, AIU::aiVector3DToNGLVec3(restScale));
+        clip.setTrack(m_nodes[i].m_track, pos, rot, scale);
+        continue;
+      }
+      //a fresh cursor per track,the frames are visited in order so the search only walks forward
+      keyCursor cursor;
+      for (unsigned int f = 0 ; f < nFrames ; ++f) {
+        //the last frame time is the duration,the clamp only covers rounding
+        float t = std::min(clip.frameTime(f), (float)anim->mDuration);
+        pos[f] = calcInterpolatedPosition(t, channel, cursor.m_position);
+        rot[f] = calcInterpolatedRotation(t, channel, cursor.m_rotation);
+        scale[f] = calcInterpolatedScaling(t, channel, cursor.m_scaling);
+      }
+      clip.setTrack(m_nodes[i].m_track, pos, rot, scale);
+    }
   }
+  m_useClip = true;
 }
 
-void SceneLoader::boneTransform(float _timeInSeconds, std::vector<ngl::Mat4>& o_transforms)
+double SceneLoader::getClipLength(unsigned int _clip) const
 {
-  ngl::Mat4 identity(1.0);
+  double ticksPerSecond = m_clipTicksPerSecond[_clip] != 0 ? m_clipTicksPerSecond[_clip] : 25.0;
+  return m_clips[_clip].duration() / ticksPerSecond;
+}
+
+int SceneLoader::findClip(const std::string &_name) const
+{
+  for (unsigned int i = 0 ; i < m_clipNames.size() ; ++i) {
+    if (m_clipNames[i] == _name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool SceneLoader::setCurrentClip(unsigned int _clip)
+{
+  if (_clip >= m_clips.size()) {
+    return false;
+  }
+  m_currentClip = _clip;
+  m_duration = m_clips[_clip].duration();
+  m_ticksPerSecond = m_clipTicksPerSecond[_clip];
+  return true;
+}
+
+void SceneLoader::boneTransform(float _timeInSeconds, std::vector<ngl::Mat4>& o_transforms, unsigned int _lod)
+{
+  traceScope trace("boneTransform");
   // calculate the current animation time at present this is set to only one animation in the scene and
   // hard coded to animaiton 0 but if we have more we would set it to the proper animation data
-  float ticksPerSecond = m_scene->mAnimations[0]->mTicksPerSecond != 0 ? m_scene->mAnimations[0]->mTicksPerSecond : 25.0f;
+  float ticksPerSecond = m_ticksPerSecond != 0 ? m_ticksPerSecond : 25.0f;
   float timeInTicks = _timeInSeconds * ticksPerSecond;
-  float animationTime = fmod(timeInTicks, m_scene->mAnimations[0]->mDuration);
+  float animationTime = fmod(timeInTicks, m_duration);
   // now traverse the animaiton heirarchy and get the transforms for the bones
-  recurseNodeHeirarchy(animationTime, m_scene->mRootNode, identity);
-  o_transforms.resize(m_numBones);
+  unsigned int lod = std::min(_lod, numLods() - 1);
+  evaluateHeirarchy(animationTime, lod);
+  copyFinalTransforms(lod, o_transforms);
+}
 
+void SceneLoader::copyFinalTransforms(unsigned int _lod, std::vector<ngl::Mat4> &o_transforms)
+{
+  // now copy this data note that we need to transpose for NGL useage
+  // this data will be copied to the shader and used in the animation skinning
+  // process.only the bones set at this lod are transposed,the merged ones still are from their last update
+  for (unsigned int i = 0 ; i < m_nodes.size() ; ++i) {
+    if (m_nodes[i].m_lastLod < _lod) {
+      continue;
+    }
+    for (int b = m_nodes[i].m_boneId ; b >= 0 ; b = m_boneData[b].m_nextBone) {
+      m_boneData[b].m_finalTransform.transpose();
+    }
+  }
+  o_transforms.resize(m_numBones);
   for (unsigned int i = 0 ; i < m_numBones ; ++i) {
-    // now copy this data note that we need to transpose for NGL useage
-    // this data will be copied to the shader and used in the animation skinning
-    // process
-    o_transforms[i] = m_boneData[i].m_finalTransform.transpose();
+    o_transforms[i] = m_boneData[i].m_finalTransform;
   }
 }
 
 
-ngl::Vec3 SceneLoader::calcInterpolatedScaling(float _animationTime, const aiNodeAnim* _nodeAnim)
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief find the key to interpolate from,so that _time is between key i and i+1.
+/// the search starts at the cursor and walks forward a few keys which covers normal
+/// playback,seeking backwards,looping or big jumps fall back to a binary search.
+/// times before the first key use key 0 and times after the last key use the last pair,
+/// keyFactor() then holds the end key
+/// @param[in] _keys aiVectorKey or aiQuatKey track with at least 2 keys
+/// @param[in] _nKeys number of keys
+/// @param[in] _time time in ticks
+/// @param[in,out] io_cursor last key found on this track,set to the new one
+//----------------------------------------------------------------------------------------------------------------------
+template <typename KEY>
+static unsigned int findKeyIndex(const KEY *_keys, unsigned int _nKeys, float _time, unsigned int &io_cursor)
+{
+  const unsigned int lastPair = _nKeys - 2;
+  const unsigned int maxSteps = 4;
+  unsigned int index = io_cursor < lastPair ? io_cursor : lastPair;
+  if (index == 0 || (float)_keys[index].mTime <= _time) {
+    unsigned int steps = 0;
+    while (index < lastPair && (float)_keys[index + 1].mTime <= _time && steps < maxSteps) {
+      ++index;
+      ++steps;
+    }
+    if (index == lastPair || _time < (float)_keys[index + 1].mTime) {
+      io_cursor = index;
+      return index;
+    }
+  }
+  // first key after _time in [1,lastPair+1]
+  unsigned int low = 1, high = lastPair + 1;
+  while (low < high) {
+    unsigned int mid = (low + high) / 2;
+    if (_time < (float)_keys[mid].mTime) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  index = low - 1 < lastPair ? low - 1 : lastPair;
+  io_cursor = index;
+  return index;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief how far _time is from key time _start to _end,clamped to [0,1] so times before the
+/// first key or after the last one hold the end key instead of extrapolating past it
+//----------------------------------------------------------------------------------------------------------------------
+static float keyFactor(double _start, double _end, float _time)
+{
+  float deltaTime = _end - _start;
+  if (deltaTime <= 0.0f) {
+    return 0.0f;
+  }
+  float factor = (_time - (float)_start) / deltaTime;
+  return std::min(std::max(factor, 0.0f), 1.0f);
+}
+
+ngl::Vec3 SceneLoader::calcInterpolatedScaling(float _animationTime, const aiNodeAnim* _nodeAnim, unsigned int &io_cursor)
 {
   // this grabs the scale from this frame and the next and returns the interpolated version
   if (_nodeAnim->mNumScalingKeys == 1) {
     return AIU::aiVector3DToNGLVec3(_nodeAnim->mScalingKeys[0].mValue);
   }
 
-  unsigned int scalingIndex = 0;
-  for (unsigned int i = 0 ; i < _nodeAnim->mNumScalingKeys - 1 ; ++i) {
-    if (_animationTime < (float)_nodeAnim->mScalingKeys[i + 1].mTime) {
-      // once we find the data break out of the loop
-      scalingIndex = i;
-      break;
-    }
-  }
+  unsigned int scalingIndex = findKeyIndex(_nodeAnim->mScalingKeys, _nodeAnim->mNumScalingKeys, _animationTime, io_cursor);
   unsigned int nextScalingIndex = (scalingIndex + 1);
   assert(nextScalingIndex < _nodeAnim->mNumScalingKeys);
-  float deltaTime = _nodeAnim->mScalingKeys[nextScalingIndex].mTime - _nodeAnim->mScalingKeys[scalingIndex].mTime;
-  float factor = (_animationTime - (float)_nodeAnim->mScalingKeys[scalingIndex].mTime) / deltaTime;
-  //assert(factor >= 0.0f && factor <= 1.0f);
+  float factor = keyFactor(_nodeAnim->mScalingKeys[scalingIndex].mTime, _nodeAnim->mScalingKeys[nextScalingIndex].mTime, _animationTime);
   ngl::Vec3 start = AIU::aiVector3DToNGLVec3(_nodeAnim->mScalingKeys[scalingIndex].mValue);
   ngl::Vec3 end   = AIU::aiVector3DToNGLVec3(_nodeAnim->mScalingKeys[nextScalingIndex].mValue);
   ngl::Vec3 delta = end - start;
   return (start + factor * delta);
 }
 
-ngl::Quaternion SceneLoader::calcInterpolatedRotation(float _animationTime, const aiNodeAnim* _nodeAnim)
+ngl::Quaternion SceneLoader::calcInterpolatedRotation(float _animationTime, const aiNodeAnim* _nodeAnim, unsigned int &io_cursor)
 {
   // we need at least two values to interpolate...
   if (_nodeAnim->mNumRotationKeys == 1) {
     return AIU::aiQuatToNGLQuat(_nodeAnim->mRotationKeys[0].mValue);
   }
 
-  unsigned int rotationIndex = 0;
-
-  for (unsigned int i = 0 ; i < _nodeAnim->mNumRotationKeys - 1 ; ++i) {
-    if (_animationTime < (float)_nodeAnim->mRotationKeys[i + 1].mTime) {
-      // search for index and break out of loop
-      rotationIndex = i;
-      break;
-    }
-  }
-
+  unsigned int rotationIndex = findKeyIndex(_nodeAnim->mRotationKeys, _nodeAnim->mNumRotationKeys, _animationTime, io_cursor);
   unsigned int nextRotationIndex = (rotationIndex + 1);
-  float deltaTime = _nodeAnim->mRotationKeys[nextRotationIndex].mTime - _nodeAnim->mRotationKeys[rotationIndex].mTime;
-  float factor = (_animationTime - (float)_nodeAnim->mRotationKeys[rotationIndex].mTime) / deltaTime;
+  float factor = keyFactor(_nodeAnim->mRotationKeys[rotationIndex].mTime, _nodeAnim->mRotationKeys[nextRotationIndex].mTime, _animationTime);
   ngl::Quaternion startRotation = AIU::aiQuatToNGLQuat(_nodeAnim->mRotationKeys[rotationIndex].mValue);
   ngl::Quaternion endRotation   = AIU::aiQuatToNGLQuat(_nodeAnim->mRotationKeys[nextRotationIndex].mValue);
   ngl::Quaternion out = ngl::Quaternion::slerp(startRotation, endRotation, factor);
@@ -208,24 +986,16 @@ ngl::Quaternion SceneLoader::calcInterpolatedRotation(float _animationTime, cons
   return out;
 }
 
-ngl::Vec3 SceneLoader::calcInterpolatedPosition(float _animationTime, const aiNodeAnim* _nodeAnim)
+ngl::Vec3 SceneLoader::calcInterpolatedPosition(float _animationTime, const aiNodeAnim* _nodeAnim, unsigned int &io_cursor)
 {
   if (_nodeAnim->mNumPositionKeys == 1) {
     return AIU::aiVector3DToNGLVec3(_nodeAnim->mPositionKeys[0].mValue);
   }
 
-  unsigned int positionIndex = 0;
-  for (unsigned int i = 0 ; i < _nodeAnim->mNumPositionKeys - 1 ; ++i) {
-    if (_animationTime < (float)_nodeAnim->mPositionKeys[i + 1].mTime) {
-      // if we find the key assign and exit search
-      positionIndex = i;
-      break;
-    }
-  }
+  unsigned int positionIndex = findKeyIndex(_nodeAnim->mPositionKeys, _nodeAnim->mNumPositionKeys, _animationTime, io_cursor);
   unsigned int nextPositionIndex = (positionIndex + 1);
   assert(nextPositionIndex < _nodeAnim->mNumPositionKeys);
-  float deltaTime = _nodeAnim->mPositionKeys[nextPositionIndex].mTime - _nodeAnim->mPositionKeys[positionIndex].mTime;
-  float factor = (_animationTime - (float)_nodeAnim->mPositionKeys[positionIndex].mTime) / deltaTime;
+  float factor = keyFactor(_nodeAnim->mPositionKeys[positionIndex].mTime, _nodeAnim->mPositionKeys[nextPositionIndex].mTime, _animationTime);
   ngl::Vec3 start = AIU::aiVector3DToNGLVec3(_nodeAnim->mPositionKeys[positionIndex].mValue);
   ngl::Vec3 end = AIU::aiVector3DToNGLVec3(_nodeAnim->mPositionKeys[nextPositionIndex].mValue);
 
@@ -246,40 +1016,186 @@ const aiNodeAnim* SceneLoader::findNodeAnim(const aiAnimation* _animation, const
   return NULL;
 }
 
-void SceneLoader::recurseNodeHeirarchy(float _animationTime, const aiNode* _node, const ngl::Mat4& _parentTransform)
+ngl::Mat4 SceneLoader::calcNodeTransform(float _animationTime, animNode &io_node)
 {
-  std::string name(_node->mName.data);
-  const aiAnimation* animation = m_scene->mAnimations[0];
-  ngl::Mat4 nodeTransform = AIU::aiMatrix4x4ToNGLMat4(_node->mTransformation);
-  const aiNodeAnim* nodeAnim = findNodeAnim(animation, name);
-  if (nodeAnim) {
-    // Interpolate scaling and generate scaling transformation matrix
-    ngl::Vec3 scale = calcInterpolatedScaling(_animationTime, nodeAnim);
-    ngl::Mat4 scaleMatrix;
-    scaleMatrix.scale(scale.m_x, scale.m_y, scale.m_z);
-    // Interpolate rotation and generate rotation transformation matrix
-    ngl::Quaternion rotation = calcInterpolatedRotation(_animationTime, nodeAnim);
-    ngl::Mat4 rotationMatrix = rotation.toMat4();
-
-    // Interpolate translation and generate translation transformation matrix
-    ngl::Vec3 translation = calcInterpolatedPosition(_animationTime, nodeAnim);
-    // Combine the above transformations
-    nodeTransform = rotationMatrix * scaleMatrix;
-    nodeTransform.m_30 = translation.m_x;
-    nodeTransform.m_31 = translation.m_y;
-    nodeTransform.m_32 = translation.m_z;
-    nodeTransform.transpose();
-  }
-
-  ngl::Mat4 globalTransform = _parentTransform * nodeTransform;
-  if (m_boneMapping.find(name) != m_boneMapping.end()) {
-    unsigned int boneIndex = m_boneMapping[name];
-    m_boneData[boneIndex].m_finalTransform = m_globalInverse * globalTransform * m_boneData[boneIndex].m_bindTransform;
+  const aiNodeAnim* nodeAnim = io_node.m_channel;
+  // Interpolate scaling and generate scaling transformation matrix
+  ngl::Vec3 scale = calcInterpolatedScaling(_animationTime, nodeAnim, io_node.m_cursor.m_scaling);
+  // Interpolate rotation and generate rotation transformation matrix
+  ngl::Quaternion rotation = calcInterpolatedRotation(_animationTime, nodeAnim, io_node.m_cursor.m_rotation);
+  // Interpolate translation and generate translation transformation matrix
+  ngl::Vec3 translation = calcInterpolatedPosition(_animationTime, nodeAnim, io_node.m_cursor.m_position);
+  return composeTransform(translation, rotation, scale);
+}
+
+ngl::Mat4 SceneLoader::composeTransform(const ngl::Vec3 &_pos, const ngl::Quaternion &_rot, const ngl::Vec3 &_scale)
+{
+  ngl::Mat4 scaleMatrix;
+  scaleMatrix.scale(_scale.m_x, _scale.m_y, _scale.m_z);
+  ngl::Mat4 rotationMatrix = _rot.toMat4();
+  // Combine the above transformations
+  ngl::Mat4 nodeTransform = rotationMatrix * scaleMatrix;
+  nodeTransform.m_30 = _pos.m_x;
+  nodeTransform.m_31 = _pos.m_y;
+  nodeTransform.m_32 = _pos.m_z;
+  nodeTransform.transpose();
+  return nodeTransform;
+}
+
+void SceneLoader::evaluateHeirarchy(float _animationTime, unsigned int _lod)
+{
+  //parents come before their children so one pass in table order sees every parent done
+  for (unsigned int i = 0 ; i < m_nodes.size() ; ++i) {
+    animNode &node = m_nodes[i];
+    if (node.m_lastLod < _lod) {
+      continue;
+    }
+    if (m_useClip && node.m_track >= 0) {
+      ngl::Vec3 pos, scale;
+      ngl::Quaternion rot;
+      m_clips[m_currentClip].sample(node.m_track, _animationTime, pos, rot, scale);
+      setNodeTransform(i, composeTransform(pos, rot, scale));
+    } else if (node.m_channel) {
+      setNodeTransform(i, calcNodeTransform(_animationTime, node));
+    } else {
+      setNodeTransform(i, m_nodeLocal[i]);
+    }
   }
+}
 
-  for (unsigned int i = 0 ; i < _node->mNumChildren ; ++i) {
-    recurseNodeHeirarchy(_animationTime, _node->mChildren[i], globalTransform);
+void SceneLoader::setNodeTransform(unsigned int _node, const ngl::Mat4 &_local)
+{
+  const animNode &node = m_nodes[_node];
+  ngl::Mat4 &globalTransform = m_nodeGlobal[_node];
+  globalTransform = node.m_parent >= 0 ? m_nodeGlobal[node.m_parent] * _local : _local;
+  for (int b = node.m_boneId ; b >= 0 ; b = m_boneData[b].m_nextBone) {
+    boneInfo &bone = m_boneData[b];
+    bone.m_finalTransform = m_globalInverse * globalTransform * bone.m_bindTransform;
+  }
+}
+
+void SceneLoader::blendTransform(const std::vector<clipLayer> &_layers, std::vector<ngl::Mat4> &o_transforms, unsigned int _lod)
+{
+  traceScope trace("blendTransform");
+  unsigned int lod = std::min(_lod, numLods() - 1);
+  evaluateBlend(_layers, lod);
+  copyFinalTransforms(lod, o_transforms);
+}
+
+void SceneLoader::evaluatePose(unsigned int _clip, float _timeInSeconds, std::vector<ngl::Mat4> &io_nodeGlobal,
+                               std::vector<ngl::Mat4> &o_finalTransforms, unsigned int _lod) const
+{
+  _lod = std::min(_lod, numLods() - 1);
+  bool useClip = m_useClip && _clip < m_clips.size();
+  double t = 0;
+  if (useClip) {
+    double ticksPerSecond = m_clipTicksPerSecond[_clip] != 0 ? m_clipTicksPerSecond[_clip] : 25.0;
+    double duration = m_clips[_clip].duration();
+    t = duration > 0 ? fmod(_timeInSeconds * ticksPerSecond, duration) : 0;
+    t = t < 0 ? t + duration : t;
+  }
+  io_nodeGlobal.resize(m_nodes.size());
+  o_finalTransforms.resize(m_numBones);
+  //the same pass as evaluateHeirarchy() with the results kept in the callers arrays
+  for (unsigned int i = 0 ; i < m_nodes.size() ; ++i) {
+    const animNode &node = m_nodes[i];
+    if (node.m_lastLod < _lod) {
+      continue;
+    }
+    ngl::Mat4 local = m_nodeLocal[i];
+    if (useClip && node.m_track >= 0) {
+      ngl::Vec3 pos, scale;
+      ngl::Quaternion rot;
+      m_clips[_clip].sample(node.m_track, t, pos, rot, scale);
+      local = composeTransform(pos, rot, scale);
+    }
+    io_nodeGlobal[i] = node.m_parent >= 0 ? io_nodeGlobal[node.m_parent] * local : local;
+    //transposed in place like boneTransform() leaves m_boneData,which is what the deformers skin with
+    for (int b = node.m_boneId ; b >= 0 ; b = m_boneData[b].m_nextBone) {
+      ngl::Mat4 &transform = o_finalTransforms[b];
+      transform = m_globalInverse * io_nodeGlobal[i] * m_boneData[b].m_bindTransform;
+      transform.transpose();
+    }
   }
 }
 
+static inline float quatDot(const ngl::Quaternion &_p, const ngl::Quaternion &_q)
+{
+  return _p.getX() * _q.getX() + _p.getY() * _q.getY() + _p.getZ() * _q.getZ() + _p.getS() * _q.getS();
+}
+
+void SceneLoader::evaluateBlend(const std::vector<clipLayer> &_layers, unsigned int _lod)
+{
+  //the time of each layer in the ticks of its clip,worked out once for all the nodes
+  std::vector<clipLayer> layers;
+  std::vector<float> ticks;
+  for (unsigned int l = 0 ; l < _layers.size() ; ++l) {
+    const clipLayer &layer = _layers[l];
+    if (!m_useClip || layer.m_clip >= m_clips.size() || layer.m_weight == 0) {
+      continue;
+    }
+    double ticksPerSecond = m_clipTicksPerSecond[layer.m_clip] != 0 ? m_clipTicksPerSecond[layer.m_clip] : 25.0;
+    double duration = m_clips[layer.m_clip].duration();
+    double t = duration > 0 ? fmod(layer.m_time * ticksPerSecond, duration) : 0;
+    layers.push_back(layer);
+    ticks.push_back(t < 0 ? t + duration : t);
+  }
 
+  for (unsigned int i = 0 ; i < m_nodes.size() ; ++i) {
+    if (m_nodes[i].m_lastLod < _lod) {
+      continue;
+    }
+    int track = m_nodes[i].m_track;
+    if (track < 0) {
+      setNodeTransform(i, m_nodeLocal[i]);
+      continue;
+    }
+    //weighted average of the normal layers,rotations flipped into the hemisphere of the first
+    ngl::Vec3 pos(0, 0, 0), scale(0, 0, 0);
+    ngl::Quaternion rot(0, 0, 0, 0), first;
+    float total = 0;
+    for (unsigned int l = 0 ; l < layers.size() ; ++l) {
+      if (layers[l].m_additive) {
+        continue;
+      }
+      ngl::Vec3 p, s;
+      ngl::Quaternion r;
+      m_clips[layers[l].m_clip].sample(track, ticks[l], p, r, s);
+      float w = layers[l].m_weight;
+      if (total == 0) {
+        first = r;
+      }
+      float wr = quatDot(r, first) < 0 ? -w : w;
+      pos += p * w;
+      scale += s * w;
+      rot = rot + r * wr;
+      total += w;
+    }
+    if (total <= 0) {
+      setNodeTransform(i, m_nodeLocal[i]);
+      continue;
+    }
+    pos = pos / total;
+    scale = scale / total;
+    rot.normalise();
+    //additive layers apply their change from the first frame of the clip
+    for (unsigned int l = 0 ; l < layers.size() ; ++l) {
+      if (!layers[l].m_additive) {
+        continue;
+      }
+      const AnimClip &clip = m_clips[layers[l].m_clip];
+      ngl::Vec3 p, s, p0, s0;
+      ngl::Quaternion r, r0;
+      clip.sample(track, ticks[l], p, r, s);
+      clip.sample(track, 0, p0, r0, s0);
+      float w = layers[l].m_weight;
+      ngl::Quaternion delta = r0.conjugate() * r;
+      rot = rot * ngl::Quaternion::slerp(ngl::Quaternion(1, 0, 0, 0), delta, w);
+      pos += (p - p0) * w;
+      scale.m_x *= s0.m_x != 0 ? 1 + w * (s.m_x / s0.m_x - 1) : 1;
+      scale.m_y *= s0.m_y != 0 ? 1 + w * (s.m_y / s0.m_y - 1) : 1;
+      scale.m_z *= s0.m_z != 0 ? 1 + w * (s.m_z / s0.m_z - 1) : 1;
+    }
+    setNodeTransform(i, composeTransform(pos, rot, scale));
+  }
+}
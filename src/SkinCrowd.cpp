@@ -0,0 +1,531 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SkinCrowd.cpp
+/// @brief member fucntions of class SkinCrowd
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include "SkinCrowd.h"
+#include"TraceRecorder.h"
+#include<cmath>
+#include<algorithm>
+
+// vertices skinned per task,small enough that a few instances still fill every thread
+const static unsigned int CROWD_SKIN_BLOCK = 4096;
+// instances posed per task,a pose is only a few hundred matrix products
+const static unsigned int CROWD_POSE_BLOCK = 8;
+// fraction of the clip between the start times of neighbouring instances,the golden ratio
+// keeps any number of instances out of step
+const static float CROWD_TIME_STEP = 0.618034f;
+// cached palettes,enough for a few 2 second clips at 60 steps a second
+const static unsigned int CROWD_POSE_CACHE = 1024;
+
+SkinCrowd::SkinCrowd()
+{
+  m_scene = 0;
+  m_width = 1;
+  m_nVerts = 0;
+  m_nBones = 0;
+  m_streamDirty = false;
+  m_vao = 0;
+  m_vaoInstances = 0;
+  m_createVAO = false;
+  m_nBlocks = 0;
+  m_meshesSkinned = 0;
+  m_frame = 0;
+  m_skinAll = true;
+  m_poseStep = 0;
+  m_poseCacheSize = CROWD_POSE_CACHE;
+  m_shareSkinned = false;
+  m_posesEvaluated = 0;
+  m_skinAlgorithm = LINEAR_BLEND;
+  m_skinNormals = true;
+  m_simdLevel = SkinKernels::detectSimdLevel();
+}
+
+SkinCrowd::~SkinCrowd()
+{
+  releaseVAO();
+}
+
+void SkinCrowd::releaseVAO()
+{
+  if (m_vao != 0) {
+    m_vao->removeVOA();
+    delete m_vao;
+    m_vao = 0;
+  }
+  m_vaoInstances = 0;
+}
+
+void SkinCrowd::setMeshData(const SceneLoader *_scene, bool _createVAO)
+{
+  releaseVAO();
+  m_scene = _scene;
+  const std::vector<vertData> &verts = m_scene->m_vertData;
+  m_nVerts = verts.size();
+  m_nBones = m_scene->numBones();
+  m_restX.resize(m_nVerts);
+  m_restY.resize(m_nVerts);
+  m_restZ.resize(m_nVerts);
+  m_restNX.resize(m_nVerts);
+  m_restNY.resize(m_nVerts);
+  m_restNZ.resize(m_nVerts);
+  m_uvs.resize(m_nVerts * 2);
+  float minX = 0, maxX = 0;
+  for (unsigned int i = 0; i < m_nVerts; ++i) {
+    m_restX[i] = verts[i].x;
+    m_restY[i] = verts[i].y;
+    m_restZ[i] = verts[i].z;
+    m_restNX[i] = verts[i].nx;
+    m_restNY[i] = verts[i].ny;
+    m_restNZ[i] = verts[i].nz;
+    m_uvs[2 * i] = verts[i].u;
+    m_uvs[2 * i + 1] = verts[i].v;
+    minX = i == 0 ? verts[i].x : std::min(minX, verts[i].x);
+    maxX = i == 0 ? verts[i].x : std::max(maxX, verts[i].x);
+  }
+  m_width = maxX - minX > 0 ? maxX - minX : 1.0f;
+
+  const std::vector<ngl::Face> &faces = m_scene->getFaces();
+  m_drawIndices.clear();
+  m_drawIndices.reserve(faces.size() * 3);
+  for (unsigned int i = 0; i < faces.size(); ++i) {
+    for (int j = 0; j < 3; ++j) {
+      m_drawIndices.push_back(faces[i].m_vert[j]);
+    }
+  }
+  //the VAO is made on the first upload,when the GL context is current
+  m_createVAO = _createVAO;
+  clearPoseCache();
+  m_drawStream.assign(m_instances.size() * m_nVerts * 6, 0.0f);
+  setNumInstances(m_instances.size());
+}
+
+void SkinCrowd::setNumInstances(unsigned int _n)
+{
+  m_instances.resize(_n);
+  m_instanceSlots.clear();
+  m_drawStream.resize((size_t)_n * m_nVerts * 6);
+  //every instance draws its own block at the rest pose until the next deform()
+  m_instanceBlocks.resize(_n);
+  for (unsigned int i = 0; i < _n; ++i) {
+    m_instanceBlocks[i] = i;
+  }
+  m_nBlocks = _n;
+  m_skinAll = true;
+  resetBlocks(0, _n);
+}
+
+void SkinCrowd::layoutGrid(unsigned int _n, float _spacing)
+{
+  setNumInstances(_n);
+  unsigned int side = (unsigned int)std::ceil(std::sqrt((float)_n));
+  float step = _spacing * m_width;
+  unsigned int nClips = m_scene != 0 ? m_scene->numClips() : 0;
+  for (unsigned int i = 0; i < _n; ++i) {
+    crowdInstance &instance = m_instances[i];
+    //centred on the origin
+    instance.m_position.m_x = ((float)(i % side) - 0.5f * (side - 1)) * step;
+    instance.m_position.m_y = 0;
+    instance.m_position.m_z = ((float)(i / side) - 0.5f * (side - 1)) * step;
+    instance.m_clip = nClips > 0 ? i % nClips : 0;
+    float length = nClips > 0 ? m_scene->getClipLength(instance.m_clip) : 0;
+    float phase = i * CROWD_TIME_STEP;
+    instance.m_time = (phase - std::floor(phase)) * length;
+    instance.m_speed = 1;
+  }
+}
+
+void SkinCrowd::advance(float _seconds)
+{
+  unsigned int nClips = m_scene != 0 ? m_scene->numClips() : 0;
+  for (unsigned int i = 0; i < m_instances.size(); ++i) {
+    crowdInstance &instance = m_instances[i];
+    instance.m_time += _seconds * instance.m_speed;
+    //kept inside the clip so the time does not lose precision as it grows
+    float length = instance.m_clip < nClips ? m_scene->getClipLength(instance.m_clip) : 0;
+    if (length > 0) {
+      instance.m_time = std::fmod(instance.m_time, length);
+      instance.m_time += instance.m_time < 0 ? length : 0;
+    }
+  }
+}
+
+void SkinCrowd::selectLods(const ngl::Mat4 &_modelView, float _fovY)
+{
+  if (m_scene == 0) {
+    return;
+  }
+  for (unsigned int i = 0; i < m_instances.size(); ++i) {
+    crowdInstance &instance = m_instances[i];
+    float size = m_scene->screenSize(_modelView, instance.m_position, _fovY);
+    m_scene->selectLod(size, instance.m_lod, instance.m_updateInterval);
+  }
+}
+
+void SkinCrowd::resetLods()
+{
+  for (unsigned int i = 0; i < m_instances.size(); ++i) {
+    m_instances[i].m_lod = 0;
+    m_instances[i].m_updateInterval = 1;
+  }
+}
+
+bool SkinCrowd::isDue(unsigned int _i) const
+{
+  unsigned int interval = m_instances[_i].m_updateInterval;
+  return m_skinAll || interval <= 1 || (m_frame + _i) % interval == 0;
+}
+
+void SkinCrowd::setSkinAlgorithm(int _i)
+{
+  SkinDeformTypes algorithm = _i == 1 ? DUAL_QUATERNION : LINEAR_BLEND;
+  //the cached palettes are in the layout of the old algorithm
+  if (algorithm != m_skinAlgorithm) {
+    clearPoseCache();
+  }
+  m_skinAlgorithm = algorithm;
+}
+
+void SkinCrowd::setPoseStep(float _seconds)
+{
+  m_poseStep = _seconds > 0 ? _seconds : 0;
+  clearPoseCache();
+}
+
+void SkinCrowd::setShareSkinned(bool _share)
+{
+  //the blocks hold poses when shared and instances when not,so they are all skinned again
+  if (_share != m_shareSkinned) {
+    clearSharedBlocks();
+    m_skinAll = true;
+  }
+  m_shareSkinned = _share;
+}
+
+void SkinCrowd::clearPoseCache()
+{
+  m_poseCache.clear();
+  m_instanceSlots.clear();
+  clearSharedBlocks();
+}
+
+void SkinCrowd::clearSharedBlocks()
+{
+  m_slotBlocks.clear();
+  m_blockSlots.clear();
+}
+
+void SkinCrowd::setSkinNormals(bool _skin)
+{
+  m_skinNormals = _skin;
+  //go back to the bind pose normals
+  if (!m_skinNormals) {
+    resetBlocks(0, m_instances.size());
+  }
+  //the shared blocks are only skinned when their pose is new
+  clearSharedBlocks();
+}
+
+void SkinCrowd::setSimdLevel(SkinKernels::SimdLevel _level)
+{
+  SkinKernels::SimdLevel best = SkinKernels::detectSimdLevel();
+  m_simdLevel = _level > best ? best : _level;
+}
+
+void SkinCrowd::resetBlocks(unsigned int _begin, unsigned int _end)
+{
+  for (unsigned int i = _begin; i < _end; ++i) {
+    float *out = &m_drawStream[(size_t)i * m_nVerts * 6];
+    for (unsigned int v = 0; v < m_nVerts; ++v, out += 6) {
+      out[0] = m_restX[v];
+      out[1] = m_restY[v];
+      out[2] = m_restZ[v];
+      out[3] = m_restNX[v];
+      out[4] = m_restNY[v];
+      out[5] = m_restNZ[v];
+    }
+  }
+  clearSharedBlocks();
+  m_streamDirty = true;
+}
+
+SkinKernels::skinStreams SkinCrowd::blockStreams(unsigned int _block)
+{
+  SkinKernels::skinStreams streams;
+  float *out = &m_drawStream[(size_t)_block * m_nVerts * 6];
+  streams.m_restX = m_restX.data();
+  streams.m_restY = m_restY.data();
+  streams.m_restZ = m_restZ.data();
+  streams.o_pos = out;
+  streams.m_posStride = 6;
+  if (m_skinNormals) {
+    streams.m_restNX = m_restNX.data();
+    streams.m_restNY = m_restNY.data();
+    streams.m_restNZ = m_restNZ.data();
+    streams.o_normal = out + 3;
+    streams.m_normalStride = 6;
+  }
+  return streams;
+}
+
+void SkinCrowd::update()
+{
+  updatePoses();
+  deform();
+}
+
+float SkinCrowd::poseTime(const crowdInstance &_instance, uint64_t &o_key) const
+{
+  o_key = (uint64_t)_instance.m_clip << 40 | (uint64_t)(_instance.m_lod & 0xff) << 32;
+  if (m_poseStep <= 0) {
+    return _instance.m_time;
+  }
+  //the last step of the clip wraps round to the first so a looping clip has no duplicate pose
+  float length = _instance.m_clip < m_scene->numClips() ? m_scene->getClipLength(_instance.m_clip) : 0;
+  unsigned int nSteps = std::max(1u, (unsigned int)(length / m_poseStep + 0.5f));
+  float step = std::floor(_instance.m_time / m_poseStep + 0.5f);
+  unsigned int index = step > 0 ? (unsigned int)step % nSteps : 0;
+  o_key |= index;
+  return index * m_poseStep;
+}
+
+void SkinCrowd::assignPoseSlots(std::vector<unsigned int> &o_missing)
+{
+  unsigned int nInstances = m_instances.size();
+  //slots from the last frame are only kept if every instance had one
+  if (m_instanceSlots.size() != nInstances) {
+    m_instanceSlots.assign(nInstances, 0);
+    m_skinAll = true;
+  }
+  o_missing.clear();
+  if (m_poseStep <= 0) {
+    //no sharing,a palette per instance skinned this frame
+    for (unsigned int i = 0; i < nInstances; ++i) {
+      m_instanceSlots[i] = i;
+      if (isDue(i)) {
+        o_missing.push_back(i);
+      }
+    }
+    m_palettes.resize((size_t)nInstances * paletteSize());
+    return;
+  }
+  //a full cache is dropped between frames,never in the middle of one.the slots are numbered
+  //again so every instance has to move to its new one
+  if (m_poseCache.size() > m_poseCacheSize) {
+    clearPoseCache();
+    m_instanceSlots.resize(nInstances);
+    m_skinAll = true;
+  }
+  for (unsigned int i = 0; i < nInstances; ++i) {
+    //an instance that is not due holds its last pose,which is still in the cache
+    if (!isDue(i)) {
+      continue;
+    }
+    uint64_t key;
+    poseTime(m_instances[i], key);
+    std::map<uint64_t, unsigned int>::iterator pose = m_poseCache.find(key);
+    if (pose == m_poseCache.end()) {
+      pose = m_poseCache.insert(std::make_pair(key, (unsigned int)m_poseCache.size())).first;
+      o_missing.push_back(i);
+    }
+    m_instanceSlots[i] = pose->second;
+  }
+  m_palettes.resize(m_poseCache.size() * paletteSize());
+}
+
+void SkinCrowd::updatePoses()
+{
+  traceScope trace("crowd poses");
+  m_posesEvaluated = 0;
+  unsigned int size = paletteSize();
+  if (m_scene == 0 || size == 0) {
+    return;
+  }
+  std::vector<unsigned int> missing;
+  assignPoseSlots(missing);
+  m_posesEvaluated = missing.size();
+  m_workers.parallelFor(missing.size(), [this, size, &missing](unsigned int _begin, unsigned int _end) {
+    traceScope block("crowd pose block");
+    //scratch for this block only,the instances keep nothing but the packed palette
+    std::vector<ngl::Mat4> nodeGlobal, transforms;
+    for (unsigned int m = _begin; m < _end; ++m) {
+      const crowdInstance &instance = m_instances[missing[m]];
+      uint64_t key;
+      m_scene->evaluatePose(instance.m_clip, poseTime(instance, key), nodeGlobal, transforms, instance.m_lod);
+      float *palette = &m_palettes[(size_t)m_instanceSlots[missing[m]] * size];
+      if (m_skinAlgorithm == DUAL_QUATERNION) {
+        SkinKernels::packDualQuatPalette(transforms, palette);
+      } else {
+        SkinKernels::packMatrixPalette(transforms, palette);
+      }
+    }
+  }, CROWD_POSE_BLOCK);
+}
+
+void SkinCrowd::deform()
+{
+  traceScope trace("crowd deform");
+  unsigned int nInstances = m_instances.size();
+  if (m_nVerts == 0 || m_nBones == 0 || nInstances == 0 || m_instanceSlots.size() != nInstances) {
+    return;
+  }
+  //pick the blocks to draw,one per pose when shared otherwise one per instance
+  m_blockInstances.clear();
+  std::vector<unsigned int> skinned;
+  if (m_shareSkinned && m_poseStep > 0) {
+    //a block keeps the skinned mesh of its pose between frames,blocks whose pose is no longer
+    //drawn are handed to the poses that have no block yet and only those are skinned
+    unsigned int nSlots = m_poseCache.size();
+    std::vector<bool> drawn(nSlots, false);
+    for (unsigned int i = 0; i < nInstances; ++i) {
+      drawn[m_instanceSlots[i]] = true;
+    }
+    m_slotBlocks.resize(nSlots, -1);
+    m_blockSlots.resize(nInstances, -1);
+    for (unsigned int b = 0; b < nInstances; ++b) {
+      if (m_blockSlots[b] >= 0 && !drawn[m_blockSlots[b]]) {
+        m_slotBlocks[m_blockSlots[b]] = -1;
+        m_blockSlots[b] = -1;
+      }
+    }
+    m_blockInstances.resize(nInstances);
+    unsigned int nextFree = 0;
+    unsigned int nBlocks = 0;
+    for (unsigned int i = 0; i < nInstances; ++i) {
+      unsigned int slot = m_instanceSlots[i];
+      int &block = m_slotBlocks[slot];
+      if (block < 0) {
+        //there are never more poses drawn than instances so a free block is always left
+        while (m_blockSlots[nextFree] >= 0) {
+          ++nextFree;
+        }
+        block = nextFree;
+        m_blockSlots[block] = slot;
+        m_blockInstances[block] = i;
+        skinned.push_back(block);
+      }
+      m_instanceBlocks[i] = block;
+      nBlocks = std::max(nBlocks, (unsigned int)block + 1);
+    }
+    m_blockInstances.resize(nBlocks);
+    //the blocks now hold poses,not instances
+    m_skinAll = false;
+  } else {
+    //an instance that is not due keeps the mesh in its block from its last update
+    for (unsigned int i = 0; i < nInstances; ++i) {
+      m_instanceBlocks[i] = i;
+      m_blockInstances.push_back(i);
+      if (isDue(i)) {
+        skinned.push_back(i);
+      }
+    }
+    m_skinAll = false;
+  }
+  m_nBlocks = m_blockInstances.size();
+  m_meshesSkinned = skinned.size();
+  ++m_frame;
+
+  //every block is cut into runs of vertices and all the runs of all the blocks
+  //are one job,so the threads stay busy for one large mesh or many small ones
+  unsigned int runsPerBlock = (m_nVerts + CROWD_SKIN_BLOCK - 1) / CROWD_SKIN_BLOCK;
+  unsigned int size = paletteSize();
+  m_workers.parallelFor(skinned.size() * runsPerBlock, [this, runsPerBlock, size, &skinned](unsigned int _begin, unsigned int _end) {
+    traceScope block("crowd deform block");
+    for (unsigned int task = _begin; task < _end; ++task) {
+      unsigned int b = skinned[task / runsPerBlock];
+      unsigned int first = (task % runsPerBlock) * CROWD_SKIN_BLOCK;
+      unsigned int last = std::min(first + CROWD_SKIN_BLOCK, m_nVerts);
+      unsigned int instance = m_blockInstances[b];
+      const skinInfluences &influences = m_scene->getInfluences(m_instances[instance].m_lod);
+      const float *palette = &m_palettes[(size_t)m_instanceSlots[instance] * size];
+      if (m_skinAlgorithm == DUAL_QUATERNION) {
+        SkinKernels::skinDQ(m_simdLevel, influences, palette, blockStreams(b), first, last);
+      } else {
+        SkinKernels::skinLBS(m_simdLevel, influences, palette, blockStreams(b), first, last);
+      }
+    }
+  }, 1);
+  m_streamDirty = true;
+}
+
+void SkinCrowd::createVAO()
+{
+  releaseVAO();
+  if (m_drawIndices.empty() || m_nVerts == 0 || m_instances.empty()) {
+    return;
+  }
+  // attribute vec3 inVert; attribute 0
+  // attribute vec2 inUV; attribute 1
+  // attribute vec3 inNormal; attribure 2
+  m_vao = ngl::VertexArrayObject::createVOA(GL_TRIANGLES);
+  m_vao->bind();
+  //buffer 0,positions and normals of every instance rewritten every frame
+  m_vao->setData(m_drawStream.size() * sizeof(float), m_drawStream[0], GL_STREAM_DRAW);
+  m_vao->setVertexAttributePointer(0, 3, GL_FLOAT, 6 * sizeof(float), 0);
+  m_vao->setVertexAttributePointer(2, 3, GL_FLOAT, 6 * sizeof(float), 3);
+  //one UV buffer and element buffer for all the instances,drawInstance() moves the
+  //position and normal pointers to the block of the instance
+  m_vao->setIndexedData(m_uvs.size() * sizeof(float), m_uvs[0],
+                        m_drawIndices.size(), &m_drawIndices[0], GL_UNSIGNED_INT, GL_STATIC_DRAW);
+  m_vao->setVertexAttributePointer(1, 2, GL_FLOAT, 2 * sizeof(float), 0);
+  m_vao->setNumIndices(m_drawIndices.size());
+  m_vao->unbind();
+  m_vaoInstances = m_instances.size();
+  m_streamDirty = false;
+}
+
+void SkinCrowd::upload()
+{
+  if (!m_createVAO) {
+    return;
+  }
+  //the buffer holds every instance so it is made again when the count changes
+  if (m_vaoInstances != m_instances.size()) {
+    createVAO();
+    return;
+  }
+  if (m_vao == 0 || !m_streamDirty) {
+    return;
+  }
+  traceScope trace("crowd upload");
+  GLsizeiptr size = m_drawStream.size() * sizeof(float);
+  //only the blocks written by the last deform(),fewer than the instances when they share
+  GLsizeiptr used = (GLsizeiptr)m_nBlocks * m_nVerts * 6 * sizeof(float);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vao->getVBOid(0));
+  //orphan the old storage so the driver does not wait for the previous frame to finish drawing
+  glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, std::min(used, size), &m_drawStream[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  m_streamDirty = false;
+}
+
+void SkinCrowd::drawInstance(unsigned int _i)
+{
+  if (m_vao == 0 || _i >= m_vaoInstances) {
+    return;
+  }
+  const GLsizei stride = 6 * sizeof(float);
+  size_t offset = (size_t)m_instanceBlocks[_i] * m_nVerts * stride;
+  m_vao->bind();
+  glBindBuffer(GL_ARRAY_BUFFER, m_vao->getVBOid(0));
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid *)offset);
+  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid *)(offset + 3 * sizeof(float)));
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  m_vao->draw();
+  m_vao->unbind();
+}
+
+size_t SkinCrowd::sharedBytes() const
+{
+  //the cached palettes belong to the poses,not to the instances
+  size_t cache = m_poseStep > 0 ? m_palettes.size() * sizeof(float) : 0;
+  return (m_restX.size() * 6 + m_uvs.size()) * sizeof(float) + m_drawIndices.size() * sizeof(GLuint) + cache;
+}
+
+size_t SkinCrowd::instanceBytes() const
+{
+  size_t palette = m_poseStep > 0 ? 0 : paletteSize();
+  return sizeof(crowdInstance) + 2 * sizeof(unsigned int) + (palette + (size_t)m_nVerts * 6) * sizeof(float);
+}
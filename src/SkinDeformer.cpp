@@ -8,21 +8,36 @@
 #include "SkinDeformer.h"
 #include "Dualquaternion.h"
 #include"Util.h"
+#include"TraceRecorder.h"
+#include<cmath>
+#include<algorithm>
 
 SkinDeformer::SkinDeformer()
 {
   m_deformMeshVAO = 0;
+  m_streamDirty = false;
   m_skinAlgorithm = LINEAR_BLEND;
+  m_nVerts = 0;
+  m_meshSet = false;
+  m_skinNormals = true;
+  m_skinTangents = false;
+  m_simdLevel = SkinKernels::detectSimdLevel();
+  m_lod = 0;
+  m_updateInterval = 1;
+  m_keyAge = 0;
+  m_keysValid = false;
 }
 
 SkinDeformer::~SkinDeformer()
 {
   m_deformMesh.clear();
-  m_deformMeshVAO->removeVOA();
-  delete m_deformMeshVAO;
+  if (m_deformMeshVAO != 0) {
+    m_deformMeshVAO->removeVOA();
+    delete m_deformMeshVAO;
+  }
 }
 
-void SkinDeformer::setMeshData(SceneLoader *_scene)
+void SkinDeformer::setMeshData(SceneLoader *_scene, bool _createVAO)
 {
     //set the scene for the deformer to access data
   m_scene = _scene;
@@ -31,13 +46,42 @@ void SkinDeformer::setMeshData(SceneLoader *_scene)
   m_deformMesh = m_scene->m_vertData;
   m_origMesh = m_scene->m_vertData;
   m_nVerts = m_scene->m_vertData.size();
+  m_restX.resize(m_nVerts);
+  m_restY.resize(m_nVerts);
+  m_restZ.resize(m_nVerts);
+  m_restNX.resize(m_nVerts);
+  m_restNY.resize(m_nVerts);
+  m_restNZ.resize(m_nVerts);
+  for (unsigned int i = 0; i < m_nVerts; ++i) {
+    m_restX[i] = m_origMesh[i].x;
+    m_restY[i] = m_origMesh[i].y;
+    m_restZ[i] = m_origMesh[i].z;
+    m_restNX[i] = m_origMesh[i].nx;
+    m_restNY[i] = m_origMesh[i].ny;
+    m_restNZ[i] = m_origMesh[i].nz;
+  }
+  //tangents are only there if the importer generated them
+  const std::vector<ngl::Vec3> &tangents = m_scene->m_tangents;
+  unsigned int nTangents = tangents.size() == m_nVerts ? m_nVerts : 0;
+  m_restTX.resize(nTangents);
+  m_restTY.resize(nTangents);
+  m_restTZ.resize(nTangents);
+  for (unsigned int i = 0; i < nTangents; ++i) {
+    m_restTX[i] = tangents[i].m_x;
+    m_restTY[i] = tangents[i].m_y;
+    m_restTZ[i] = tangents[i].m_z;
+  }
+  m_deformTangents.clear();
+  if (m_skinTangents) {
+    m_deformTangents = tangents;
+  }
   m_meshSet = true;
-  setDeformMeshVAO();
+  m_keysValid = false;
+  setDeformMeshVAO(_createVAO);
 }
 
 void SkinDeformer::setSkinAlgorithm(int _i)
 {
-  std::cout << "Setting" << _i << std::endl;
   switch (_i) {
   case 0: {
     m_skinAlgorithm = LINEAR_BLEND;
@@ -54,7 +98,120 @@ void SkinDeformer::setSkinAlgorithm(int _i)
   }
 }
 
-void SkinDeformer::setDeformMeshVAO()
+void SkinDeformer::setNumThreads(unsigned int _n)
+{
+  m_workers.setNumThreads(_n);
+}
+
+void SkinDeformer::setSimdLevel(SkinKernels::SimdLevel _level)
+{
+  SkinKernels::SimdLevel best = SkinKernels::detectSimdLevel();
+  m_simdLevel = _level > best ? best : _level;
+}
+
+void SkinDeformer::setSkinNormals(bool _skin)
+{
+  m_skinNormals = _skin;
+  //go back to the bind pose normals
+  if (!m_skinNormals) {
+    for (unsigned int i = 0; i < m_nVerts; ++i) {
+      m_deformMesh[i].nx = m_origMesh[i].nx;
+      m_deformMesh[i].ny = m_origMesh[i].ny;
+      m_deformMesh[i].nz = m_origMesh[i].nz;
+    }
+  }
+}
+
+void SkinDeformer::setSkinTangents(bool _skin)
+{
+  m_skinTangents = _skin;
+  m_deformTangents.clear();
+  if (m_skinTangents && m_meshSet) {
+    m_deformTangents = m_scene->m_tangents;
+  }
+}
+
+void SkinDeformer::setLod(unsigned int _lod)
+{
+  m_lod = _lod;
+}
+
+void SkinDeformer::setUpdateInterval(unsigned int _frames)
+{
+  m_updateInterval = _frames > 1 ? _frames : 1;
+}
+
+bool SkinDeformer::needsPose() const
+{
+  return m_updateInterval <= 1 || !m_keysValid || m_keyAge + 1 >= m_updateInterval;
+}
+
+const skinInfluences &SkinDeformer::lodInfluences() const
+{
+  return m_scene->getInfluences(m_lod);
+}
+
+SkinKernels::skinStreams SkinDeformer::kernelStreams()
+{
+  SkinKernels::skinStreams streams;
+  //positions and normals are written straight into each vertData
+  const unsigned int vertStride = sizeof(vertData) / sizeof(float);
+  streams.m_restX = m_restX.data();
+  streams.m_restY = m_restY.data();
+  streams.m_restZ = m_restZ.data();
+  streams.o_pos = &m_deformMesh[0].x;
+  streams.m_posStride = vertStride;
+  if (m_skinNormals) {
+    streams.m_restNX = m_restNX.data();
+    streams.m_restNY = m_restNY.data();
+    streams.m_restNZ = m_restNZ.data();
+    streams.o_normal = &m_deformMesh[0].nx;
+    streams.m_normalStride = vertStride;
+  }
+  if (m_skinTangents && !m_restTX.empty() && m_deformTangents.size() == m_nVerts) {
+    streams.m_restTX = m_restTX.data();
+    streams.m_restTY = m_restTY.data();
+    streams.m_restTZ = m_restTZ.data();
+    streams.o_tangent = &m_deformTangents[0].m_x;
+    streams.m_tangentStride = sizeof(ngl::Vec3) / sizeof(float);
+  }
+  return streams;
+}
+
+ngl::Real SkinDeformer::checkKernel()
+{
+  if (m_nVerts == 0 || m_skinAlgorithm == STRETCH_TWIST) {
+    return 0;
+  }
+  std::vector<vertData> reference;
+  if (m_skinAlgorithm == LINEAR_BLEND) {
+    deformMesh_LSBReference(0, m_nVerts);
+    reference = m_deformMesh;
+    SkinKernels::packMatrixPalette(m_scene->m_boneData, m_matrixPalette);
+    deformMesh_LSB(0, m_nVerts);
+  } else {
+    buildDQPalette();
+    deformMesh_DQReference(0, m_nVerts);
+    reference = m_deformMesh;
+    deformMesh_DQ(0, m_nVerts);
+  }
+  const skinInfluences &influences = lodInfluences();
+  ngl::Real maxError = 0;
+  for (unsigned int i = 0; i < m_nVerts; ++i) {
+    maxError = std::max(maxError, std::abs(reference[i].x - m_deformMesh[i].x));
+    maxError = std::max(maxError, std::abs(reference[i].y - m_deformMesh[i].y));
+    maxError = std::max(maxError, std::abs(reference[i].z - m_deformMesh[i].z));
+    //a vertex without bones has no normal transform to compare
+    if (m_skinNormals && influences.count(i) > 0) {
+      maxError = std::max(maxError, std::abs(reference[i].nx - m_deformMesh[i].nx));
+      maxError = std::max(maxError, std::abs(reference[i].ny - m_deformMesh[i].ny));
+      maxError = std::max(maxError, std::abs(reference[i].nz - m_deformMesh[i].nz));
+    }
+  }
+  return maxError;
+}
+
+void SkinDeformer::setDeformMeshVAO(bool _createVAO)
 {
   if (m_deformMeshVAO != 0) {
     m_deformMeshVAO->unbind();
@@ -64,32 +221,84 @@ void SkinDeformer::setDeformMeshVAO()
   // attribute vec3 inVert; attribute 0
   // attribute vec2 inUV; attribute 1
   // attribute vec3 inNormal; attribure 2
-  // u,v,nx,ny,nz,x,y,z
 
-  std::vector<ngl::Face> faces = m_scene->getFaceList();
+  //the face list only changes with the mesh so the index buffer is built here once
+  const std::vector<ngl::Face> &faces = m_scene->getFaces();
   int nFaces = m_scene->getNumFaces();
-  std::vector<vertData> drawVerts;
+  m_drawIndices.clear();
+  m_drawIndices.reserve(nFaces * 3);
   for (int i = 0; i < nFaces; ++i) {
-    ngl::Face f = faces[i];
     for (int j = 0; j < 3; ++j) {
-      int vertNo = f.m_vert[j];
-      drawVerts.push_back(m_deformMesh[vertNo]);
+      m_drawIndices.push_back(faces[i].m_vert[j]);
     }
   }
-  int nDrawVerts = drawVerts.size();
+  std::vector<float> uvs(m_nVerts * 2);
+  for (unsigned int i = 0; i < m_nVerts; ++i) {
+    uvs[2 * i] = m_deformMesh[i].u;
+    uvs[2 * i + 1] = m_deformMesh[i].v;
+  }
+  m_drawStream.resize(m_nVerts * 6);
+  packDrawStream(0, m_nVerts);
+  m_streamDirty = false;
+  m_deformMeshVAO = 0;
+  if (!_createVAO || m_drawIndices.empty() || m_nVerts == 0) {
+    return;
+  }
+
   m_deformMeshVAO = ngl::VertexArrayObject::createVOA(GL_TRIANGLES);
   m_deformMeshVAO->bind();
-  m_deformMeshVAO->setData(nDrawVerts * sizeof(vertData), drawVerts[0].u);
-  //vertex
-  m_deformMeshVAO->setVertexAttributePointer(0, 3, GL_FLOAT, sizeof(vertData), 5);
-  m_deformMeshVAO->setVertexAttributePointer(1, 2, GL_FLOAT, sizeof(vertData), 0);
-  m_deformMeshVAO->setVertexAttributePointer(2, 3, GL_FLOAT, sizeof(vertData), 2);
-  m_deformMeshVAO->setNumIndices(nDrawVerts);
+  //buffer 0,positions and normals rewritten every frame
+  m_deformMeshVAO->setData(m_drawStream.size() * sizeof(float), m_drawStream[0], GL_STREAM_DRAW);
+  m_deformMeshVAO->setVertexAttributePointer(0, 3, GL_FLOAT, 6 * sizeof(float), 0);
+  m_deformMeshVAO->setVertexAttributePointer(2, 3, GL_FLOAT, 6 * sizeof(float), 3);
+  //the UVs never change and carry the element buffer so the mesh is drawn with glDrawElements
+  m_deformMeshVAO->setIndexedData(uvs.size() * sizeof(float), uvs[0],
+                                  m_drawIndices.size(), &m_drawIndices[0], GL_UNSIGNED_INT, GL_STATIC_DRAW);
+  m_deformMeshVAO->setVertexAttributePointer(1, 2, GL_FLOAT, 2 * sizeof(float), 0);
+  m_deformMeshVAO->setNumIndices(m_drawIndices.size());
   m_deformMeshVAO->unbind();
 }
 
+void SkinDeformer::packDrawStream(unsigned int _begin, unsigned int _end)
+{
+  for (unsigned int i = _begin; i < _end; ++i) {
+    const vertData &v = m_deformMesh[i];
+    float *out = &m_drawStream[6 * i];
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+    out[3] = v.nx;
+    out[4] = v.ny;
+    out[5] = v.nz;
+  }
+}
+
+void SkinDeformer::uploadDrawStream()
+{
+  traceScope trace("upload");
+  GLsizeiptr size = m_drawStream.size() * sizeof(float);
+  glBindBuffer(GL_ARRAY_BUFFER, m_deformMeshVAO->getVBOid(0));
+  //orphan the old storage so the driver does not wait for the previous frame to finish drawing
+  glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, size, &m_drawStream[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  m_streamDirty = false;
+}
+
+void SkinDeformer::upload()
+{
+  //upload at draw time rather than in update() so the GL context is always current
+  if (m_deformMeshVAO != 0 && m_streamDirty) {
+    uploadDrawStream();
+  }
+}
+
 void SkinDeformer::drawDeformMesh()
 {
+  if (m_deformMeshVAO == 0) {
+    return;
+  }
+  upload();
   m_deformMeshVAO->bind();
   m_deformMeshVAO->draw();
   m_deformMeshVAO->unbind();
@@ -97,32 +306,141 @@ void SkinDeformer::drawDeformMesh()
 
 void SkinDeformer::update()
 {
+  deform();
+  prepareDraw();
+}
+
+void SkinDeformer::deform()
+{
+  traceScope trace("deform");
+  if (m_updateInterval <= 1) {
+    m_keysValid = false;
+    skin();
+    return;
+  }
+  if (needsPose()) {
+    //the new pose becomes the newer key and the mesh starts from the one before
+    skin();
+    m_keyFrom.swap(m_keyTo);
+    m_keyTo.resize(m_nVerts * 6);
+    m_workers.parallelFor(m_nVerts, [this](unsigned int _begin, unsigned int _end) {
+      traceScope block("key block");
+      storeKey(_begin, _end);
+    });
+    if (!m_keysValid) {
+      m_keyFrom = m_keyTo;
+    }
+    m_keysValid = true;
+    m_keyAge = 0;
+  } else {
+    ++m_keyAge;
+  }
+  float t = (float)m_keyAge / m_updateInterval;
+  m_workers.parallelFor(m_nVerts, [this, t](unsigned int _begin, unsigned int _end) {
+    traceScope block("interpolate block");
+    interpolateKeys(t, _begin, _end);
+  });
+}
+
+void SkinDeformer::storeKey(unsigned int _begin, unsigned int _end)
+{
+  for (unsigned int i = _begin; i < _end; ++i) {
+    const vertData &v = m_deformMesh[i];
+    float *key = &m_keyTo[6 * i];
+    key[0] = v.x;
+    key[1] = v.y;
+    key[2] = v.z;
+    key[3] = v.nx;
+    key[4] = v.ny;
+    key[5] = v.nz;
+  }
+}
+
+void SkinDeformer::interpolateKeys(float _t, unsigned int _begin, unsigned int _end)
+{
+  //the normals are not renormalised,the shader does that
+  for (unsigned int i = _begin; i < _end; ++i) {
+    const float *from = &m_keyFrom[6 * i];
+    const float *to = &m_keyTo[6 * i];
+    vertData &v = m_deformMesh[i];
+    v.x = from[0] + (to[0] - from[0]) * _t;
+    v.y = from[1] + (to[1] - from[1]) * _t;
+    v.z = from[2] + (to[2] - from[2]) * _t;
+    v.nx = from[3] + (to[3] - from[3]) * _t;
+    v.ny = from[4] + (to[4] - from[4]) * _t;
+    v.nz = from[5] + (to[5] - from[5]) * _t;
+  }
+}
+
+void SkinDeformer::skin()
+{
+  //every vertex is deformed independently so the range is split across the worker threads
   if (m_skinAlgorithm == LINEAR_BLEND) {
-    deformMesh_LSB();
+    SkinKernels::packMatrixPalette(m_scene->m_boneData, m_matrixPalette);
+    m_workers.parallelFor(m_nVerts, [this](unsigned int _begin, unsigned int _end) {
+      traceScope block("deform block");
+      deformMesh_LSB(_begin, _end);
+    });
   } else if (m_skinAlgorithm == DUAL_QUATERNION) {
-    deformMesh_DQ();
+    buildDQPalette();
+    m_workers.parallelFor(m_nVerts, [this](unsigned int _begin, unsigned int _end) {
+      traceScope block("deform block");
+      deformMesh_DQ(_begin, _end);
+    });
   } else if (m_skinAlgorithm == STRETCH_TWIST) {
-    deformMesh_STBS();
+    m_workers.parallelFor(m_nVerts, [this](unsigned int _begin, unsigned int _end) {
+      traceScope block("deform block");
+      deformMesh_STBS(_begin, _end);
+    });
   }
+}
 
-  setDeformMeshVAO();
+void SkinDeformer::prepareDraw()
+{
+  traceScope trace("prepareDraw");
+  //only the positions and normals are refreshed,the VAO and UV buffer are kept
+  m_workers.parallelFor(m_nVerts, [this](unsigned int _begin, unsigned int _end) {
+    traceScope block("pack block");
+    packDrawStream(_begin, _end);
+  });
+  m_streamDirty = true;
 }
 
-void SkinDeformer::deformMesh_LSB()
+void SkinDeformer::deformMesh_LSB(unsigned int _begin, unsigned int _end)
 {
+  if (m_nVerts == 0) {
+    return;
+  }
+  SkinKernels::skinLBS(m_simdLevel, lodInfluences(), m_matrixPalette.data(),
+                       kernelStreams(), _begin, _end);
+}
+
+// transform the rest normal of a vertex by the 3x3 part of a matrix and normalise it
+static void setDeformedNormal(const ngl::Mat4 &_transform, vertData &io_v)
+{
+  ngl::Vec4 normal = ngl::Vec4(io_v.nx, io_v.ny, io_v.nz, 0.0f) * _transform;
+  ngl::Vec3 n(normal.m_x, normal.m_y, normal.m_z);
+  n.normalize();
+  io_v.nx = n.m_x;
+  io_v.ny = n.m_y;
+  io_v.nz = n.m_z;
+}
 
-  for (unsigned int i = 0; i < m_nVerts; i++) {
-      //getting the bone index
-    vertexBoneInfo attachedBones = m_scene->m_vertexBoneData[i];
+void SkinDeformer::deformMesh_LSBReference(unsigned int _begin, unsigned int _end)
+{
+  const skinInfluences &influences = lodInfluences();
+  const std::vector<boneInfo> &bones = m_scene->m_boneData;
+  for (unsigned int i = _begin; i < _end; i++) {
     ngl::Mat4 totalBoneTransform;
     totalBoneTransform.null();
-    for (int j = 0; j < attachedBones.m_nWeights; ++j) {
+    unsigned int nWeights = influences.count(i);
+    for (unsigned int j = 0; j < nWeights; ++j) {
         //get the bone weight
-      ngl::Real weight = attachedBones.m_skinWeights[j];
+      ngl::Real weight = influences.weight(i, j);
       //get the bone ID
-      unsigned int boneId = attachedBones.m_boneIds[j];
+      unsigned int boneId = influences.boneId(i, j);
       //get the final transform using the ID
-      ngl::Mat4 boneTransform = m_scene->m_boneData[boneId].m_finalTransform;
+      const ngl::Mat4 &boneTransform = bones[boneId].m_finalTransform;
       totalBoneTransform += (boneTransform * weight);
     }
     //get the orig point
@@ -133,35 +451,63 @@ void SkinDeformer::deformMesh_LSB()
     v.x = newPoint.m_x;
     v.y = newPoint.m_y;
     v.z = newPoint.m_z;
+    //normals take the inverse transpose so they stay perpendicular to a scaled surface
+    if (m_skinNormals && nWeights > 0) {
+      ngl::Mat4 normalTransform = totalBoneTransform;
+      normalTransform.inverse();
+      normalTransform.transpose();
+      setDeformedNormal(normalTransform, v);
+    }
     m_deformMesh[i] = v;
   }
 }
 
+void SkinDeformer::buildDQPalette()
+{
+  const std::vector<boneInfo> &bones = m_scene->m_boneData;
+  m_dqPalette.resize(bones.size());
+  for (unsigned int i = 0; i < bones.size(); ++i) {
+    //convert matrix to unit DualQuaternion once per bone
+    m_dqPalette[i].fromMatrix(bones[i].m_finalTransform);
+  }
+  SkinKernels::packDualQuatPalette(m_dqPalette, m_dqPackedPalette);
+}
+
 //--------------------------------------------------------------------------------
 // both DQ and STBS work on rigid transforms
 //there any meshes imported should not have scale values
 //even a overall scale transformation will not work
 //----------------------------------------------------------------------------------
-void SkinDeformer::deformMesh_DQ()
+void SkinDeformer::deformMesh_DQ(unsigned int _begin, unsigned int _end)
 {
-  DualQuaternion boneTransform;
-  DualQuaternion  temp;
-  for (unsigned int i = 0; i < m_nVerts; i++) {
+  if (m_nVerts == 0) {
+    return;
+  }
+  //blend and transform straight from the packed palette without going through a matrix
+  SkinKernels::skinDQ(m_simdLevel, lodInfluences(), m_dqPackedPalette.data(),
+                      kernelStreams(), _begin, _end);
+}
 
-    vertexBoneInfo attachedBones = m_scene->m_vertexBoneData[i];
+void SkinDeformer::deformMesh_DQReference(unsigned int _begin, unsigned int _end)
+{
+  const skinInfluences &influences = lodInfluences();
+  for (unsigned int i = _begin; i < _end; i++) {
+    unsigned int nWeights = influences.count(i);
+    //a vertex without bones keeps its rest position,there is no first bone to read
+    if (nWeights == 0) {
+      m_deformMesh[i] = m_origMesh[i];
+      continue;
+    }
     DualQuaternion totalBoneTransform;
     //initialize to zero
     totalBoneTransform.setNull();
-    //storing the first bone dual quaternion for flipping calculation
-    DualQuaternion firstBone_dq;
-    int firstBoneId = attachedBones.m_boneIds[0];
-    //convert matrix to DualQuaternion
-    firstBone_dq.fromMatrix(m_scene->m_boneData[firstBoneId].m_finalTransform);
-    ngl::Quaternion firstReal(firstBone_dq.getReal());
-    for (int j = 0; j < attachedBones.m_nWeights; ++j) {
-      ngl::Real weight = attachedBones.m_skinWeights[j];
-      unsigned int boneId = attachedBones.m_boneIds[j];
-      boneTransform.fromMatrix(m_scene->m_boneData[boneId].m_finalTransform);
+    //storing the first bone rotation for flipping calculation
+    unsigned int firstBoneId = influences.boneId(i, 0);
+    ngl::Quaternion firstReal(m_dqPalette[firstBoneId].getReal());
+    for (unsigned int j = 0; j < nWeights; ++j) {
+      ngl::Real weight = influences.weight(i, j);
+      unsigned int boneId = influences.boneId(i, j);
+      const DualQuaternion &boneTransform = m_dqPalette[boneId];
       //antipodality checking
       if (Quat_dot(boneTransform.getReal(), firstReal) < 0.0f)
         weight *= -1;
@@ -171,10 +517,15 @@ void SkinDeformer::deformMesh_DQ()
     totalBoneTransform = totalBoneTransform * (1 / totalBoneTransform.magnitude());
     vertData v = m_origMesh[i];
     ngl::Vec3 origPoint(v.x, v.y, v.z);
-    ngl::Vec3 newPoint =  multMatrix(origPoint, totalBoneTransform.toMatrix());
+    ngl::Mat4 boneMatrix = totalBoneTransform.toMatrix();
+    ngl::Vec3 newPoint =  multMatrix(origPoint, boneMatrix);
     v.x = newPoint.m_x;
     v.y = newPoint.m_y;
     v.z = newPoint.m_z;
+    //a unit dual quaternion is rigid so the normal takes the same rotation
+    if (m_skinNormals) {
+      setDeformedNormal(boneMatrix, v);
+    }
     m_deformMesh[i] = v;
   }
 }
@@ -183,21 +534,23 @@ void SkinDeformer::deformMesh_DQ()
 //
 //----------------------------------------------------------------------------------
 
-void SkinDeformer::deformMesh_STBS()
+void SkinDeformer::deformMesh_STBS(unsigned int _begin, unsigned int _end)
 {
-  for (unsigned int i = 0; i < m_nVerts; i++) {
-    vertexBoneInfo attachedBones = m_scene->m_vertexBoneData[i];
+  const skinInfluences &influences = lodInfluences();
+  const std::vector<boneInfo> &bones = m_scene->m_boneData;
+  for (unsigned int i = _begin; i < _end; i++) {
     vertData v = m_origMesh[i];
     ngl::Vec3 origPoint(v.x, v.y, v.z);
     ngl::Vec3 newPoint = 0, finalPos = 0;
     ngl::Real  finalRotation = 0;
-    for (int j = 0; j < attachedBones.m_nWeights; ++j) {
+    unsigned int nWeights = influences.count(i);
+    for (unsigned int j = 0; j < nWeights; ++j) {
       ngl::Vec3 currentPosA, currentPosB;
-      ngl::Real weight = attachedBones.m_skinWeights[j];
-      unsigned int boneId = attachedBones.m_boneIds[j];
+      ngl::Real weight = influences.weight(i, j);
+      unsigned int boneId = influences.boneId(i, j);
       //get the rest position (bind)of child joint A
-      ngl::Vec3 restPosA = m_scene->m_boneData[boneId].m_restPosition;
-      ngl::Mat4 boneTransform = m_scene->m_boneData[boneId].m_finalTransform;
+      ngl::Vec3 restPosA = bones[boneId].m_restPosition;
+      ngl::Mat4 boneTransform = bones[boneId].m_finalTransform;
       ngl::Mat3 rotA, rotB;
       ngl::Real rotA_Z = 0, rotB_Z = 0, t = 0, finalRotZ;
       //get the rotation3x3 matrix and the translate
@@ -206,10 +559,10 @@ void SkinDeformer::deformMesh_STBS()
       rotA_Z = decomposeRotation(rotA).m_z;
       finalRotZ = rotA_Z;
       //if it has parent
-      if (m_scene->m_boneData[boneId].m_parentBoneId != -1) {
-        int parentId = m_scene->m_boneData[boneId].m_parentBoneId;
-        boneTransform = m_scene->m_boneData[parentId].m_finalTransform;
-        ngl::Vec3 restPosB = m_scene->m_boneData[parentId].m_restPosition;
+      if (bones[boneId].m_parentBoneId != -1) {
+        int parentId = bones[boneId].m_parentBoneId;
+        boneTransform = bones[parentId].m_finalTransform;
+        ngl::Vec3 restPosB = bones[parentId].m_restPosition;
         //initial Bone length
         ngl::Real restLength = (restPosA - restPosB).length();
         ngl::Real currentLength = (currentPosA - currentPosB).length();
@@ -236,6 +589,16 @@ void SkinDeformer::deformMesh_STBS()
     v.x = newPoint.m_x;
     v.y = newPoint.m_y;
     v.z = newPoint.m_z;
+    //normals and tangents only take the blended rotation
+    if (m_skinNormals) {
+      ngl::Vec3 normal = rotation * ngl::Vec3(v.nx, v.ny, v.nz);
+      v.nx = normal.m_x;
+      v.ny = normal.m_y;
+      v.nz = normal.m_z;
+    }
+    if (m_skinTangents && i < m_deformTangents.size() && !m_restTX.empty()) {
+      m_deformTangents[i] = rotation * ngl::Vec3(m_restTX[i], m_restTY[i], m_restTZ[i]);
+    }
     m_deformMesh[i] = v;
   }
 }
@@ -0,0 +1,841 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SkinKernels.cpp
+/// @brief vectorised inner loops for the skin deformers
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include "SkinKernels.h"
+#include<cmath>
+#include<cstring>
+
+// the SSE2 kernel is built whenever the compiler targets it (the .pro passes -msse2)
+// the AVX2 kernel is compiled with a function level target so the rest of the
+// program does not require AVX2 and it is only called when the cpu reports it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define SKIN_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace SkinKernels
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+// scalar kernels,also used for the vertices left over at the end of the SIMD loops
+//----------------------------------------------------------------------------------------------------------------------
+static inline void normalize3(float &_x, float &_y, float &_z)
+{
+  float len2 = _x * _x + _y * _y + _z * _z;
+  if (len2 > 0.0f) {
+    float invLength = 1.0f / std::sqrt(len2);
+    _x *= invLength;
+    _y *= invLength;
+    _z *= invLength;
+  }
+}
+
+static inline void applyLBS(const float *_m, const skinStreams &_streams, unsigned int _i)
+{
+  float x = _streams.m_restX[_i];
+  float y = _streams.m_restY[_i];
+  float z = _streams.m_restZ[_i];
+  //row vector times matrix as in multMatrix()
+  float px = x * _m[0] + y * _m[4] + z * _m[8] + _m[12];
+  float py = x * _m[1] + y * _m[5] + z * _m[9] + _m[13];
+  float pz = x * _m[2] + y * _m[6] + z * _m[10] + _m[14];
+  float pw = x * _m[3] + y * _m[7] + z * _m[11] + _m[15];
+  if (pw > 1) {
+    px /= pw;
+    py /= pw;
+    pz /= pw;
+  }
+  float *pos = _streams.o_pos + _i * _streams.m_posStride;
+  pos[0] = px;
+  pos[1] = py;
+  pos[2] = pz;
+
+  if (_streams.o_normal) {
+    //the rows of the cofactor matrix are cross products of the rows of the 3x3
+    float c0x = _m[5] * _m[10] - _m[6] * _m[9];
+    float c0y = _m[6] * _m[8] - _m[4] * _m[10];
+    float c0z = _m[4] * _m[9] - _m[5] * _m[8];
+    float c1x = _m[9] * _m[2] - _m[10] * _m[1];
+    float c1y = _m[10] * _m[0] - _m[8] * _m[2];
+    float c1z = _m[8] * _m[1] - _m[9] * _m[0];
+    float c2x = _m[1] * _m[6] - _m[2] * _m[5];
+    float c2y = _m[2] * _m[4] - _m[0] * _m[6];
+    float c2z = _m[0] * _m[5] - _m[1] * _m[4];
+    float nx = _streams.m_restNX[_i];
+    float ny = _streams.m_restNY[_i];
+    float nz = _streams.m_restNZ[_i];
+    float ox = nx * c0x + ny * c1x + nz * c2x;
+    float oy = nx * c0y + ny * c1y + nz * c2y;
+    float oz = nx * c0z + ny * c1z + nz * c2z;
+    normalize3(ox, oy, oz);
+    float *normal = _streams.o_normal + _i * _streams.m_normalStride;
+    normal[0] = ox;
+    normal[1] = oy;
+    normal[2] = oz;
+  }
+  if (_streams.o_tangent) {
+    float tx = _streams.m_restTX[_i];
+    float ty = _streams.m_restTY[_i];
+    float tz = _streams.m_restTZ[_i];
+    float ox = tx * _m[0] + ty * _m[4] + tz * _m[8];
+    float oy = tx * _m[1] + ty * _m[5] + tz * _m[9];
+    float oz = tx * _m[2] + ty * _m[6] + tz * _m[10];
+    normalize3(ox, oy, oz);
+    float *tangent = _streams.o_tangent + _i * _streams.m_tangentStride;
+    tangent[0] = ox;
+    tangent[1] = oy;
+    tangent[2] = oz;
+  }
+}
+
+static void skinLBS_Scalar(
+                            const skinInfluences &_influences,
+                            const float *_palette,
+                            const skinStreams &_streams,
+                            unsigned int _begin,
+                            unsigned int _end
+                          )
+{
+  for (unsigned int i = _begin; i < _end; ++i) {
+    //weighted sum of the bone matrices,same order as the ngl::Mat4 version
+    float m[16] = {0};
+    unsigned int nWeights = _influences.count(i);
+    for (unsigned int j = 0; j < nWeights; ++j) {
+      float weight = _influences.weight(i, j);
+      const float *bone = _palette + 16 * _influences.boneId(i, j);
+      for (int e = 0; e < 16; ++e) {
+        m[e] += bone[e] * weight;
+      }
+    }
+    applyLBS(m, _streams, i);
+  }
+}
+
+static inline void rotateDQ(const float *_dq, float _x, float _y, float _z, float *o_v)
+{
+  const float rx = _dq[0], ry = _dq[1], rz = _dq[2], rw = _dq[3];
+  //p+2r x (r x p+w*p)
+  float cx = ry * _z - rz * _y + rw * _x;
+  float cy = rz * _x - rx * _z + rw * _y;
+  float cz = rx * _y - ry * _x + rw * _z;
+  o_v[0] = _x + 2.0f * (ry * cz - rz * cy);
+  o_v[1] = _y + 2.0f * (rz * cx - rx * cz);
+  o_v[2] = _z + 2.0f * (rx * cy - ry * cx);
+}
+
+static inline void applyDQ(const float *_dq, const skinStreams &_streams, unsigned int _i)
+{
+  const float rx = _dq[0], ry = _dq[1], rz = _dq[2], rw = _dq[3];
+  const float dx = _dq[4], dy = _dq[5], dz = _dq[6], dw = _dq[7];
+  float *pos = _streams.o_pos + _i * _streams.m_posStride;
+  rotateDQ(_dq, _streams.m_restX[_i], _streams.m_restY[_i], _streams.m_restZ[_i], pos);
+  //translation,vector part of 2*dual*realConjugate
+  pos[0] += 2.0f * (rw * dx - dw * rx + ry * dz - rz * dy);
+  pos[1] += 2.0f * (rw * dy - dw * ry + rz * dx - rx * dz);
+  pos[2] += 2.0f * (rw * dz - dw * rz + rx * dy - ry * dx);
+  //a unit rotation keeps the length so there is nothing to renormalise
+  if (_streams.o_normal) {
+    rotateDQ(_dq, _streams.m_restNX[_i], _streams.m_restNY[_i], _streams.m_restNZ[_i],
+             _streams.o_normal + _i * _streams.m_normalStride);
+  }
+  if (_streams.o_tangent) {
+    rotateDQ(_dq, _streams.m_restTX[_i], _streams.m_restTY[_i], _streams.m_restTZ[_i],
+             _streams.o_tangent + _i * _streams.m_tangentStride);
+  }
+}
+
+static void skinDQ_Scalar(
+                           const skinInfluences &_influences,
+                           const float *_palette,
+                           const skinStreams &_streams,
+                           unsigned int _begin,
+                           unsigned int _end
+                         )
+{
+  for (unsigned int i = _begin; i < _end; ++i) {
+    float b[8] = {0};
+    unsigned int nWeights = _influences.count(i);
+    //rotation of the first bone for the antipodality check
+    const float *first = 0;
+    for (unsigned int j = 0; j < nWeights; ++j) {
+      float weight = _influences.weight(i, j);
+      const float *dq = _palette + 8 * _influences.boneId(i, j);
+      if (j == 0) {
+        first = dq;
+      }
+      if (dq[0] * first[0] + dq[1] * first[1] + dq[2] * first[2] + dq[3] * first[3] < 0.0f) {
+        weight = -weight;
+      }
+      for (int e = 0; e < 8; ++e) {
+        b[e] += dq[e] * weight;
+      }
+    }
+    //unweighted vertices are left with a zero DualQuaternion which keeps the rest data
+    float len2 = b[0] * b[0] + b[1] * b[1] + b[2] * b[2] + b[3] * b[3];
+    float invLength = len2 > 0.0f ? 1.0f / std::sqrt(len2) : 0.0f;
+    for (int e = 0; e < 8; ++e) {
+      b[e] *= invLength;
+    }
+    applyDQ(b, _streams, i);
+  }
+}
+
+#ifdef SKIN_X86_SIMD
+//----------------------------------------------------------------------------------------------------------------------
+// SSE2 kernels,4 vertices per iteration
+// each register holds the same component for the 4 vertices
+//----------------------------------------------------------------------------------------------------------------------
+static inline void storeLanesSSE2(__m128 _x, __m128 _y, __m128 _z, float *o_data, unsigned int _stride, unsigned int _first)
+{
+  float tx[4], ty[4], tz[4];
+  _mm_storeu_ps(tx, _x);
+  _mm_storeu_ps(ty, _y);
+  _mm_storeu_ps(tz, _z);
+  for (int l = 0; l < 4; ++l) {
+    float *out = o_data + (_first + l) * _stride;
+    out[0] = tx[l];
+    out[1] = ty[l];
+    out[2] = tz[l];
+  }
+}
+
+// the weights of 4 vertices of a slot as floats whatever size they are stored in
+static inline __m128 loadWeightsSSE2(const skinInfluences &_influences, unsigned int _index)
+{
+  const unsigned char *data = _influences.weightData(_index);
+  const __m128i zero = _mm_setzero_si128();
+  switch (_influences.m_weightBytes) {
+  case 1 : {
+    int packed;
+    std::memcpy(&packed, data, 4);
+    __m128i w = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+    return _mm_mul_ps(_mm_cvtepi32_ps(w), _mm_set1_ps(1.0f / 255.0f));
+  }
+  case 2 : {
+    __m128i w = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)data), zero);
+    return _mm_mul_ps(_mm_cvtepi32_ps(w), _mm_set1_ps(1.0f / 65535.0f));
+  }
+  default :
+    return _mm_loadu_ps((const float *)data);
+  }
+}
+
+// the bone ids of 4 vertices of a slot
+static inline void loadIdsSSE2(const skinInfluences &_influences, unsigned int _index, unsigned int *o_ids)
+{
+  for (int l = 0; l < 4; ++l) {
+    o_ids[l] = _influences.boneIdAt(_index + l);
+  }
+}
+
+static inline bool uniformIdsSSE2(const unsigned int *_ids)
+{
+  return _ids[0] == _ids[1] && _ids[0] == _ids[2] && _ids[0] == _ids[3];
+}
+
+static inline void normalize3SSE2(__m128 &_x, __m128 &_y, __m128 &_z)
+{
+  __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_x, _x), _mm_mul_ps(_y, _y)), _mm_mul_ps(_z, _z));
+  __m128 mask = _mm_cmpgt_ps(len2, _mm_setzero_ps());
+  __m128 invLength = _mm_or_ps(_mm_and_ps(mask, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len2))),
+                               _mm_andnot_ps(mask, _mm_set1_ps(1.0f)));
+  _x = _mm_mul_ps(_x, invLength);
+  _y = _mm_mul_ps(_y, invLength);
+  _z = _mm_mul_ps(_z, invLength);
+}
+
+static inline void applyLBS_SSE2(const __m128 *_m, const skinStreams &_streams, unsigned int _i)
+{
+  __m128 x = _mm_loadu_ps(_streams.m_restX + _i);
+  __m128 y = _mm_loadu_ps(_streams.m_restY + _i);
+  __m128 z = _mm_loadu_ps(_streams.m_restZ + _i);
+  __m128 px = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _m[0]), _mm_mul_ps(y, _m[4])), _mm_mul_ps(z, _m[8])), _m[12]);
+  __m128 py = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _m[1]), _mm_mul_ps(y, _m[5])), _mm_mul_ps(z, _m[9])), _m[13]);
+  __m128 pz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _m[2]), _mm_mul_ps(y, _m[6])), _mm_mul_ps(z, _m[10])), _m[14]);
+  __m128 pw = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _m[3]), _mm_mul_ps(y, _m[7])), _mm_mul_ps(z, _m[11])), _m[15]);
+  //divide by w only where w > 1
+  __m128 mask = _mm_cmpgt_ps(pw, _mm_set1_ps(1.0f));
+  px = _mm_or_ps(_mm_and_ps(mask, _mm_div_ps(px, pw)), _mm_andnot_ps(mask, px));
+  py = _mm_or_ps(_mm_and_ps(mask, _mm_div_ps(py, pw)), _mm_andnot_ps(mask, py));
+  pz = _mm_or_ps(_mm_and_ps(mask, _mm_div_ps(pz, pw)), _mm_andnot_ps(mask, pz));
+  storeLanesSSE2(px, py, pz, _streams.o_pos, _streams.m_posStride, _i);
+
+  if (_streams.o_normal) {
+    __m128 c0x = _mm_sub_ps(_mm_mul_ps(_m[5], _m[10]), _mm_mul_ps(_m[6], _m[9]));
+    __m128 c0y = _mm_sub_ps(_mm_mul_ps(_m[6], _m[8]), _mm_mul_ps(_m[4], _m[10]));
+    __m128 c0z = _mm_sub_ps(_mm_mul_ps(_m[4], _m[9]), _mm_mul_ps(_m[5], _m[8]));
+    __m128 c1x = _mm_sub_ps(_mm_mul_ps(_m[9], _m[2]), _mm_mul_ps(_m[10], _m[1]));
+    __m128 c1y = _mm_sub_ps(_mm_mul_ps(_m[10], _m[0]), _mm_mul_ps(_m[8], _m[2]));
+    __m128 c1z = _mm_sub_ps(_mm_mul_ps(_m[8], _m[1]), _mm_mul_ps(_m[9], _m[0]));
+    __m128 c2x = _mm_sub_ps(_mm_mul_ps(_m[1], _m[6]), _mm_mul_ps(_m[2], _m[5]));
+    __m128 c2y = _mm_sub_ps(_mm_mul_ps(_m[2], _m[4]), _mm_mul_ps(_m[0], _m[6]));
+    __m128 c2z = _mm_sub_ps(_mm_mul_ps(_m[0], _m[5]), _mm_mul_ps(_m[1], _m[4]));
+    __m128 nx = _mm_loadu_ps(_streams.m_restNX + _i);
+    __m128 ny = _mm_loadu_ps(_streams.m_restNY + _i);
+    __m128 nz = _mm_loadu_ps(_streams.m_restNZ + _i);
+    __m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, c0x), _mm_mul_ps(ny, c1x)), _mm_mul_ps(nz, c2x));
+    __m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, c0y), _mm_mul_ps(ny, c1y)), _mm_mul_ps(nz, c2y));
+    __m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, c0z), _mm_mul_ps(ny, c1z)), _mm_mul_ps(nz, c2z));
+    normalize3SSE2(ox, oy, oz);
+    storeLanesSSE2(ox, oy, oz, _streams.o_normal, _streams.m_normalStride, _i);
+  }
+  if (_streams.o_tangent) {
+    __m128 tx = _mm_loadu_ps(_streams.m_restTX + _i);
+    __m128 ty = _mm_loadu_ps(_streams.m_restTY + _i);
+    __m128 tz = _mm_loadu_ps(_streams.m_restTZ + _i);
+    __m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, _m[0]), _mm_mul_ps(ty, _m[4])), _mm_mul_ps(tz, _m[8]));
+    __m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, _m[1]), _mm_mul_ps(ty, _m[5])), _mm_mul_ps(tz, _m[9]));
+    __m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, _m[2]), _mm_mul_ps(ty, _m[6])), _mm_mul_ps(tz, _m[10]));
+    normalize3SSE2(ox, oy, oz);
+    storeLanesSSE2(ox, oy, oz, _streams.o_tangent, _streams.m_tangentStride, _i);
+  }
+}
+
+// the 4 bone matrices of a slot are loaded a row at a time and transposed so each
+// register holds the same matrix element for the 4 vertices
+static void skinLBS_SSE2(
+                          const skinInfluences &_influences,
+                          const float *_palette,
+                          const skinStreams &_streams,
+                          unsigned int _begin,
+                          unsigned int _end
+                        )
+{
+  const unsigned int nVerts = _influences.m_nVerts;
+  const unsigned int nSlots = _influences.m_maxInfluences;
+  const __m128 zero = _mm_setzero_ps();
+  unsigned int i = _begin;
+  for (; i + 4 <= _end; i += 4) {
+    __m128 m[16];
+    for (int e = 0; e < 16; ++e) {
+      m[e] = zero;
+    }
+    for (unsigned int k = 0; k < nSlots; ++k) {
+      __m128 weight = loadWeightsSSE2(_influences, k * nVerts + i);
+      //all 4 vertices have run out of influences
+      if (_mm_movemask_ps(_mm_cmpneq_ps(weight, zero)) == 0) {
+        continue;
+      }
+      unsigned int ids[4];
+      loadIdsSSE2(_influences, k * nVerts + i, ids);
+      const float *b0 = _palette + 16 * ids[0];
+      //the 4 vertices share the bone,common once the vertices are sorted by influence
+      if (uniformIdsSSE2(ids)) {
+        for (int e = 0; e < 16; ++e) {
+          m[e] = _mm_add_ps(m[e], _mm_mul_ps(_mm_set1_ps(b0[e]), weight));
+        }
+        continue;
+      }
+      const float *b1 = _palette + 16 * ids[1];
+      const float *b2 = _palette + 16 * ids[2];
+      const float *b3 = _palette + 16 * ids[3];
+      for (int r = 0; r < 4; ++r) {
+        __m128 c0 = _mm_loadu_ps(b0 + 4 * r);
+        __m128 c1 = _mm_loadu_ps(b1 + 4 * r);
+        __m128 c2 = _mm_loadu_ps(b2 + 4 * r);
+        __m128 c3 = _mm_loadu_ps(b3 + 4 * r);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        m[4 * r + 0] = _mm_add_ps(m[4 * r + 0], _mm_mul_ps(c0, weight));
+        m[4 * r + 1] = _mm_add_ps(m[4 * r + 1], _mm_mul_ps(c1, weight));
+        m[4 * r + 2] = _mm_add_ps(m[4 * r + 2], _mm_mul_ps(c2, weight));
+        m[4 * r + 3] = _mm_add_ps(m[4 * r + 3], _mm_mul_ps(c3, weight));
+      }
+    }
+    applyLBS_SSE2(m, _streams, i);
+  }
+  skinLBS_Scalar(_influences, _palette, _streams, i, _end);
+}
+
+// the real and dual halves of the 4 bones are transposed so each register holds one
+// component for the 4 vertices
+static inline void loadDualQuatSSE2(const float *_palette, const unsigned int *_ids, __m128 *o_dq)
+{
+  const float *b0 = _palette + 8 * _ids[0];
+  if (uniformIdsSSE2(_ids)) {
+    for (int e = 0; e < 8; ++e) {
+      o_dq[e] = _mm_set1_ps(b0[e]);
+    }
+    return;
+  }
+  const float *b1 = _palette + 8 * _ids[1];
+  const float *b2 = _palette + 8 * _ids[2];
+  const float *b3 = _palette + 8 * _ids[3];
+  o_dq[0] = _mm_loadu_ps(b0);
+  o_dq[1] = _mm_loadu_ps(b1);
+  o_dq[2] = _mm_loadu_ps(b2);
+  o_dq[3] = _mm_loadu_ps(b3);
+  _MM_TRANSPOSE4_PS(o_dq[0], o_dq[1], o_dq[2], o_dq[3]);
+  o_dq[4] = _mm_loadu_ps(b0 + 4);
+  o_dq[5] = _mm_loadu_ps(b1 + 4);
+  o_dq[6] = _mm_loadu_ps(b2 + 4);
+  o_dq[7] = _mm_loadu_ps(b3 + 4);
+  _MM_TRANSPOSE4_PS(o_dq[4], o_dq[5], o_dq[6], o_dq[7]);
+}
+
+static inline void rotateDQSSE2(const __m128 *_b, __m128 _x, __m128 _y, __m128 _z, __m128 &o_x, __m128 &o_y, __m128 &o_z)
+{
+  const __m128 two = _mm_set1_ps(2.0f);
+  __m128 cx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_b[1], _z), _mm_mul_ps(_b[2], _y)), _mm_mul_ps(_b[3], _x));
+  __m128 cy = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_b[2], _x), _mm_mul_ps(_b[0], _z)), _mm_mul_ps(_b[3], _y));
+  __m128 cz = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_b[0], _y), _mm_mul_ps(_b[1], _x)), _mm_mul_ps(_b[3], _z));
+  o_x = _mm_add_ps(_x, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(_b[1], cz), _mm_mul_ps(_b[2], cy))));
+  o_y = _mm_add_ps(_y, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(_b[2], cx), _mm_mul_ps(_b[0], cz))));
+  o_z = _mm_add_ps(_z, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(_b[0], cy), _mm_mul_ps(_b[1], cx))));
+}
+
+static inline void applyDQ_SSE2(const __m128 *_b, const skinStreams &_streams, unsigned int _i)
+{
+  const __m128 two = _mm_set1_ps(2.0f);
+  __m128 px, py, pz;
+  rotateDQSSE2(_b, _mm_loadu_ps(_streams.m_restX + _i), _mm_loadu_ps(_streams.m_restY + _i),
+               _mm_loadu_ps(_streams.m_restZ + _i), px, py, pz);
+  __m128 tx = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_b[3], _b[4]), _mm_mul_ps(_b[7], _b[0])), _mm_mul_ps(_b[2], _b[5])), _mm_mul_ps(_b[1], _b[6]));
+  __m128 ty = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_b[3], _b[5]), _mm_mul_ps(_b[7], _b[1])), _mm_mul_ps(_b[0], _b[6])), _mm_mul_ps(_b[2], _b[4]));
+  __m128 tz = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_b[3], _b[6]), _mm_mul_ps(_b[7], _b[2])), _mm_mul_ps(_b[1], _b[4])), _mm_mul_ps(_b[0], _b[5]));
+  px = _mm_add_ps(px, _mm_mul_ps(two, tx));
+  py = _mm_add_ps(py, _mm_mul_ps(two, ty));
+  pz = _mm_add_ps(pz, _mm_mul_ps(two, tz));
+  storeLanesSSE2(px, py, pz, _streams.o_pos, _streams.m_posStride, _i);
+  if (_streams.o_normal) {
+    __m128 nx, ny, nz;
+    rotateDQSSE2(_b, _mm_loadu_ps(_streams.m_restNX + _i), _mm_loadu_ps(_streams.m_restNY + _i),
+                 _mm_loadu_ps(_streams.m_restNZ + _i), nx, ny, nz);
+    storeLanesSSE2(nx, ny, nz, _streams.o_normal, _streams.m_normalStride, _i);
+  }
+  if (_streams.o_tangent) {
+    __m128 ox, oy, oz;
+    rotateDQSSE2(_b, _mm_loadu_ps(_streams.m_restTX + _i), _mm_loadu_ps(_streams.m_restTY + _i),
+                 _mm_loadu_ps(_streams.m_restTZ + _i), ox, oy, oz);
+    storeLanesSSE2(ox, oy, oz, _streams.o_tangent, _streams.m_tangentStride, _i);
+  }
+}
+
+static void skinDQ_SSE2(
+                         const skinInfluences &_influences,
+                         const float *_palette,
+                         const skinStreams &_streams,
+                         unsigned int _begin,
+                         unsigned int _end
+                       )
+{
+  const unsigned int nVerts = _influences.m_nVerts;
+  const unsigned int nSlots = _influences.m_maxInfluences;
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 signBit = _mm_set1_ps(-0.0f);
+  unsigned int i = _begin;
+  for (; i + 4 <= _end && nSlots > 0; i += 4) {
+    unsigned int ids[4];
+    loadIdsSSE2(_influences, i, ids);
+    __m128 first[8];
+    loadDualQuatSSE2(_palette, ids, first);
+    __m128 b[8];
+    for (int e = 0; e < 8; ++e) {
+      b[e] = zero;
+    }
+    for (unsigned int k = 0; k < nSlots; ++k) {
+      __m128 weight = loadWeightsSSE2(_influences, k * nVerts + i);
+      if (_mm_movemask_ps(_mm_cmpneq_ps(weight, zero)) == 0) {
+        continue;
+      }
+      loadIdsSSE2(_influences, k * nVerts + i, ids);
+      __m128 dq[8];
+      loadDualQuatSSE2(_palette, ids, dq);
+      __m128 dot = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dq[0], first[0]), _mm_mul_ps(dq[1], first[1])),
+                                         _mm_mul_ps(dq[2], first[2])), _mm_mul_ps(dq[3], first[3]));
+      //flip the weight of bones in the opposite hemisphere to the first one
+      weight = _mm_xor_ps(weight, _mm_and_ps(_mm_cmplt_ps(dot, zero), signBit));
+      for (int e = 0; e < 8; ++e) {
+        b[e] = _mm_add_ps(b[e], _mm_mul_ps(dq[e], weight));
+      }
+    }
+    __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b[0], b[0]), _mm_mul_ps(b[1], b[1])),
+                                        _mm_mul_ps(b[2], b[2])), _mm_mul_ps(b[3], b[3]));
+    //zero for unweighted vertices so they keep the rest data
+    __m128 invLength = _mm_and_ps(_mm_cmpgt_ps(len2, zero), _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len2)));
+    for (int e = 0; e < 8; ++e) {
+      b[e] = _mm_mul_ps(b[e], invLength);
+    }
+    applyDQ_SSE2(b, _streams, i);
+  }
+  skinDQ_Scalar(_influences, _palette, _streams, i, _end);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// AVX2 kernels,8 vertices per iteration using gathers for the bone data
+//----------------------------------------------------------------------------------------------------------------------
+// the weights and ids are widened in register so the packed table is read as it is stored
+__attribute__((target("avx2")))
+static inline __m256 loadWeightsAVX2(const skinInfluences &_influences, unsigned int _index)
+{
+  const unsigned char *data = _influences.weightData(_index);
+  switch (_influences.m_weightBytes) {
+  case 1 :
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)data))),
+                         _mm256_set1_ps(1.0f / 255.0f));
+  case 2 :
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)data))),
+                         _mm256_set1_ps(1.0f / 65535.0f));
+  default :
+    return _mm256_loadu_ps((const float *)data);
+  }
+}
+
+// the bone ids of 8 vertices widened to 32 bit for the gathers
+__attribute__((target("avx2")))
+static inline __m256i loadIdsAVX2(const skinInfluences &_influences, unsigned int _index)
+{
+  const unsigned char *data = _influences.idData(_index);
+  switch (_influences.m_idBytes) {
+  case 1 : return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)data));
+  case 2 : return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)data));
+  default : return _mm256_loadu_si256((const __m256i *)data);
+  }
+}
+
+// true when the 8 vertices use the same bone,the bone data is then broadcast instead of gathered
+__attribute__((target("avx2")))
+static inline bool uniformIdsAVX2(__m256i _ids)
+{
+  __m256i first = _mm256_permutevar8x32_epi32(_ids, _mm256_setzero_si256());
+  return _mm256_movemask_epi8(_mm256_cmpeq_epi32(_ids, first)) == -1;
+}
+
+// the first _n floats of the bone data of 8 vertices,one register per float
+__attribute__((target("avx2")))
+static inline void loadBoneAVX2(const float *_palette, __m256i _ids, int _stride, int _n, __m256 *o_data)
+{
+  if (uniformIdsAVX2(_ids)) {
+    const float *bone = _palette + _stride * _mm256_cvtsi256_si32(_ids);
+    for (int e = 0; e < _n; ++e) {
+      o_data[e] = _mm256_broadcast_ss(bone + e);
+    }
+    return;
+  }
+  __m256i offset = _mm256_mullo_epi32(_ids, _mm256_set1_epi32(_stride));
+  for (int e = 0; e < _n; ++e) {
+    o_data[e] = _mm256_i32gather_ps(_palette + e, offset, 4);
+  }
+}
+
+__attribute__((target("avx2")))
+static inline void storeLanesAVX2(__m256 _x, __m256 _y, __m256 _z, float *o_data, unsigned int _stride, unsigned int _first)
+{
+  float tx[8], ty[8], tz[8];
+  _mm256_storeu_ps(tx, _x);
+  _mm256_storeu_ps(ty, _y);
+  _mm256_storeu_ps(tz, _z);
+  for (int l = 0; l < 8; ++l) {
+    float *out = o_data + (_first + l) * _stride;
+    out[0] = tx[l];
+    out[1] = ty[l];
+    out[2] = tz[l];
+  }
+}
+
+__attribute__((target("avx2")))
+static inline void normalize3AVX2(__m256 &_x, __m256 &_y, __m256 &_z)
+{
+  __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_x, _x), _mm256_mul_ps(_y, _y)), _mm256_mul_ps(_z, _z));
+  __m256 mask = _mm256_cmp_ps(len2, _mm256_setzero_ps(), _CMP_GT_OQ);
+  __m256 invLength = _mm256_blendv_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(len2)), mask);
+  _x = _mm256_mul_ps(_x, invLength);
+  _y = _mm256_mul_ps(_y, invLength);
+  _z = _mm256_mul_ps(_z, invLength);
+}
+
+__attribute__((target("avx2")))
+static inline void applyLBS_AVX2(const __m256 *_m, const skinStreams &_streams, unsigned int _i)
+{
+  __m256 x = _mm256_loadu_ps(_streams.m_restX + _i);
+  __m256 y = _mm256_loadu_ps(_streams.m_restY + _i);
+  __m256 z = _mm256_loadu_ps(_streams.m_restZ + _i);
+  __m256 px = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _m[0]), _mm256_mul_ps(y, _m[4])), _mm256_mul_ps(z, _m[8])), _m[12]);
+  __m256 py = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _m[1]), _mm256_mul_ps(y, _m[5])), _mm256_mul_ps(z, _m[9])), _m[13]);
+  __m256 pz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _m[2]), _mm256_mul_ps(y, _m[6])), _mm256_mul_ps(z, _m[10])), _m[14]);
+  __m256 pw = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _m[3]), _mm256_mul_ps(y, _m[7])), _mm256_mul_ps(z, _m[11])), _m[15]);
+  __m256 mask = _mm256_cmp_ps(pw, _mm256_set1_ps(1.0f), _CMP_GT_OQ);
+  px = _mm256_blendv_ps(px, _mm256_div_ps(px, pw), mask);
+  py = _mm256_blendv_ps(py, _mm256_div_ps(py, pw), mask);
+  pz = _mm256_blendv_ps(pz, _mm256_div_ps(pz, pw), mask);
+  storeLanesAVX2(px, py, pz, _streams.o_pos, _streams.m_posStride, _i);
+
+  if (_streams.o_normal) {
+    __m256 c0x = _mm256_sub_ps(_mm256_mul_ps(_m[5], _m[10]), _mm256_mul_ps(_m[6], _m[9]));
+    __m256 c0y = _mm256_sub_ps(_mm256_mul_ps(_m[6], _m[8]), _mm256_mul_ps(_m[4], _m[10]));
+    __m256 c0z = _mm256_sub_ps(_mm256_mul_ps(_m[4], _m[9]), _mm256_mul_ps(_m[5], _m[8]));
+    __m256 c1x = _mm256_sub_ps(_mm256_mul_ps(_m[9], _m[2]), _mm256_mul_ps(_m[10], _m[1]));
+    __m256 c1y = _mm256_sub_ps(_mm256_mul_ps(_m[10], _m[0]), _mm256_mul_ps(_m[8], _m[2]));
+    __m256 c1z = _mm256_sub_ps(_mm256_mul_ps(_m[8], _m[1]), _mm256_mul_ps(_m[9], _m[0]));
+    __m256 c2x = _mm256_sub_ps(_mm256_mul_ps(_m[1], _m[6]), _mm256_mul_ps(_m[2], _m[5]));
+    __m256 c2y = _mm256_sub_ps(_mm256_mul_ps(_m[2], _m[4]), _mm256_mul_ps(_m[0], _m[6]));
+    __m256 c2z = _mm256_sub_ps(_mm256_mul_ps(_m[0], _m[5]), _mm256_mul_ps(_m[1], _m[4]));
+    __m256 nx = _mm256_loadu_ps(_streams.m_restNX + _i);
+    __m256 ny = _mm256_loadu_ps(_streams.m_restNY + _i);
+    __m256 nz = _mm256_loadu_ps(_streams.m_restNZ + _i);
+    __m256 ox = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, c0x), _mm256_mul_ps(ny, c1x)), _mm256_mul_ps(nz, c2x));
+    __m256 oy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, c0y), _mm256_mul_ps(ny, c1y)), _mm256_mul_ps(nz, c2y));
+    __m256 oz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, c0z), _mm256_mul_ps(ny, c1z)), _mm256_mul_ps(nz, c2z));
+    normalize3AVX2(ox, oy, oz);
+    storeLanesAVX2(ox, oy, oz, _streams.o_normal, _streams.m_normalStride, _i);
+  }
+  if (_streams.o_tangent) {
+    __m256 tx = _mm256_loadu_ps(_streams.m_restTX + _i);
+    __m256 ty = _mm256_loadu_ps(_streams.m_restTY + _i);
+    __m256 tz = _mm256_loadu_ps(_streams.m_restTZ + _i);
+    __m256 ox = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, _m[0]), _mm256_mul_ps(ty, _m[4])), _mm256_mul_ps(tz, _m[8]));
+    __m256 oy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, _m[1]), _mm256_mul_ps(ty, _m[5])), _mm256_mul_ps(tz, _m[9]));
+    __m256 oz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, _m[2]), _mm256_mul_ps(ty, _m[6])), _mm256_mul_ps(tz, _m[10]));
+    normalize3AVX2(ox, oy, oz);
+    storeLanesAVX2(ox, oy, oz, _streams.o_tangent, _streams.m_tangentStride, _i);
+  }
+}
+
+__attribute__((target("avx2")))
+static void skinLBS_AVX2(
+                          const skinInfluences &_influences,
+                          const float *_palette,
+                          const skinStreams &_streams,
+                          unsigned int _begin,
+                          unsigned int _end
+                        )
+{
+  const unsigned int nVerts = _influences.m_nVerts;
+  const unsigned int nSlots = _influences.m_maxInfluences;
+  const __m256 zero = _mm256_setzero_ps();
+  unsigned int i = _begin;
+  for (; i + 8 <= _end; i += 8) {
+    __m256 m[16];
+    for (int e = 0; e < 16; ++e) {
+      m[e] = zero;
+    }
+    for (unsigned int k = 0; k < nSlots; ++k) {
+      __m256 weight = loadWeightsAVX2(_influences, k * nVerts + i);
+      if (_mm256_movemask_ps(_mm256_cmp_ps(weight, zero, _CMP_NEQ_OQ)) == 0) {
+        continue;
+      }
+      __m256 bone[16];
+      loadBoneAVX2(_palette, loadIdsAVX2(_influences, k * nVerts + i), 16, 16, bone);
+      for (int e = 0; e < 16; ++e) {
+        m[e] = _mm256_add_ps(m[e], _mm256_mul_ps(bone[e], weight));
+      }
+    }
+    applyLBS_AVX2(m, _streams, i);
+  }
+  skinLBS_SSE2(_influences, _palette, _streams, i, _end);
+}
+
+__attribute__((target("avx2")))
+static inline void rotateDQAVX2(const __m256 *_b, __m256 _x, __m256 _y, __m256 _z, __m256 &o_x, __m256 &o_y, __m256 &o_z)
+{
+  const __m256 two = _mm256_set1_ps(2.0f);
+  __m256 cx = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_b[1], _z), _mm256_mul_ps(_b[2], _y)), _mm256_mul_ps(_b[3], _x));
+  __m256 cy = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_b[2], _x), _mm256_mul_ps(_b[0], _z)), _mm256_mul_ps(_b[3], _y));
+  __m256 cz = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_b[0], _y), _mm256_mul_ps(_b[1], _x)), _mm256_mul_ps(_b[3], _z));
+  o_x = _mm256_add_ps(_x, _mm256_mul_ps(two, _mm256_sub_ps(_mm256_mul_ps(_b[1], cz), _mm256_mul_ps(_b[2], cy))));
+  o_y = _mm256_add_ps(_y, _mm256_mul_ps(two, _mm256_sub_ps(_mm256_mul_ps(_b[2], cx), _mm256_mul_ps(_b[0], cz))));
+  o_z = _mm256_add_ps(_z, _mm256_mul_ps(two, _mm256_sub_ps(_mm256_mul_ps(_b[0], cy), _mm256_mul_ps(_b[1], cx))));
+}
+
+__attribute__((target("avx2")))
+static inline void applyDQ_AVX2(const __m256 *_b, const skinStreams &_streams, unsigned int _i)
+{
+  const __m256 two = _mm256_set1_ps(2.0f);
+  __m256 px, py, pz;
+  rotateDQAVX2(_b, _mm256_loadu_ps(_streams.m_restX + _i), _mm256_loadu_ps(_streams.m_restY + _i),
+               _mm256_loadu_ps(_streams.m_restZ + _i), px, py, pz);
+  __m256 tx = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(_b[3], _b[4]), _mm256_mul_ps(_b[7], _b[0])), _mm256_mul_ps(_b[2], _b[5])), _mm256_mul_ps(_b[1], _b[6]));
+  __m256 ty = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(_b[3], _b[5]), _mm256_mul_ps(_b[7], _b[1])), _mm256_mul_ps(_b[0], _b[6])), _mm256_mul_ps(_b[2], _b[4]));
+  __m256 tz = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(_b[3], _b[6]), _mm256_mul_ps(_b[7], _b[2])), _mm256_mul_ps(_b[1], _b[4])), _mm256_mul_ps(_b[0], _b[5]));
+  px = _mm256_add_ps(px, _mm256_mul_ps(two, tx));
+  py = _mm256_add_ps(py, _mm256_mul_ps(two, ty));
+  pz = _mm256_add_ps(pz, _mm256_mul_ps(two, tz));
+  storeLanesAVX2(px, py, pz, _streams.o_pos, _streams.m_posStride, _i);
+  if (_streams.o_normal) {
+    __m256 nx, ny, nz;
+    rotateDQAVX2(_b, _mm256_loadu_ps(_streams.m_restNX + _i), _mm256_loadu_ps(_streams.m_restNY + _i),
+                 _mm256_loadu_ps(_streams.m_restNZ + _i), nx, ny, nz);
+    storeLanesAVX2(nx, ny, nz, _streams.o_normal, _streams.m_normalStride, _i);
+  }
+  if (_streams.o_tangent) {
+    __m256 ox, oy, oz;
+    rotateDQAVX2(_b, _mm256_loadu_ps(_streams.m_restTX + _i), _mm256_loadu_ps(_streams.m_restTY + _i),
+                 _mm256_loadu_ps(_streams.m_restTZ + _i), ox, oy, oz);
+    storeLanesAVX2(ox, oy, oz, _streams.o_tangent, _streams.m_tangentStride, _i);
+  }
+}
+
+__attribute__((target("avx2")))
+static void skinDQ_AVX2(
+                         const skinInfluences &_influences,
+                         const float *_palette,
+                         const skinStreams &_streams,
+                         unsigned int _begin,
+                         unsigned int _end
+                       )
+{
+  const unsigned int nVerts = _influences.m_nVerts;
+  const unsigned int nSlots = _influences.m_maxInfluences;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 signBit = _mm256_set1_ps(-0.0f);
+  unsigned int i = _begin;
+  for (; i + 8 <= _end && nSlots > 0; i += 8) {
+    __m256 first[4];
+    loadBoneAVX2(_palette, loadIdsAVX2(_influences, i), 8, 4, first);
+    __m256 b[8];
+    for (int e = 0; e < 8; ++e) {
+      b[e] = zero;
+    }
+    for (unsigned int k = 0; k < nSlots; ++k) {
+      __m256 weight = loadWeightsAVX2(_influences, k * nVerts + i);
+      if (_mm256_movemask_ps(_mm256_cmp_ps(weight, zero, _CMP_NEQ_OQ)) == 0) {
+        continue;
+      }
+      __m256 dq[8];
+      loadBoneAVX2(_palette, loadIdsAVX2(_influences, k * nVerts + i), 8, 8, dq);
+      __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dq[0], first[0]), _mm256_mul_ps(dq[1], first[1])),
+                                               _mm256_mul_ps(dq[2], first[2])), _mm256_mul_ps(dq[3], first[3]));
+      weight = _mm256_xor_ps(weight, _mm256_and_ps(_mm256_cmp_ps(dot, zero, _CMP_LT_OQ), signBit));
+      for (int e = 0; e < 8; ++e) {
+        b[e] = _mm256_add_ps(b[e], _mm256_mul_ps(dq[e], weight));
+      }
+    }
+    __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[0], b[0]), _mm256_mul_ps(b[1], b[1])),
+                                              _mm256_mul_ps(b[2], b[2])), _mm256_mul_ps(b[3], b[3]));
+    __m256 invLength = _mm256_and_ps(_mm256_cmp_ps(len2, zero, _CMP_GT_OQ), _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(len2)));
+    for (int e = 0; e < 8; ++e) {
+      b[e] = _mm256_mul_ps(b[e], invLength);
+    }
+    applyDQ_AVX2(b, _streams, i);
+  }
+  skinDQ_SSE2(_influences, _palette, _streams, i, _end);
+}
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+SimdLevel detectSimdLevel()
+{
+#ifdef SKIN_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SIMD_AVX2;
+  }
+  //the build already requires SSE2
+  return SIMD_SSE2;
+#else
+  return SIMD_SCALAR;
+#endif
+}
+
+const char *simdLevelName(SimdLevel _level)
+{
+  switch (_level) {
+  case SIMD_AVX2 : return "AVX2";
+  case SIMD_SSE2 : return "SSE2";
+  default : return "Scalar";
+  }
+}
+
+void packMatrixPalette(const std::vector<boneInfo> &_bones, std::vector<float> &o_palette)
+{
+  o_palette.resize(16 * _bones.size());
+  for (unsigned int i = 0; i < _bones.size(); ++i) {
+    const ngl::Mat4 &m = _bones[i].m_finalTransform;
+    for (int e = 0; e < 16; ++e) {
+      o_palette[16 * i + e] = m.m_openGL[e];
+    }
+  }
+}
+
+void packMatrixPalette(const std::vector<ngl::Mat4> &_transforms, float *o_palette)
+{
+  for (unsigned int i = 0; i < _transforms.size(); ++i) {
+    for (int e = 0; e < 16; ++e) {
+      o_palette[16 * i + e] = _transforms[i].m_openGL[e];
+    }
+  }
+}
+
+static inline void packDualQuat(const DualQuaternion &_dq, float *o_out)
+{
+  ngl::Quaternion real = _dq.getReal();
+  ngl::Quaternion dual = _dq.getDual();
+  o_out[0] = real.getX();
+  o_out[1] = real.getY();
+  o_out[2] = real.getZ();
+  o_out[3] = real.getS();
+  o_out[4] = dual.getX();
+  o_out[5] = dual.getY();
+  o_out[6] = dual.getZ();
+  o_out[7] = dual.getS();
+}
+
+void packDualQuatPalette(const std::vector<DualQuaternion> &_dq, std::vector<float> &o_palette)
+{
+  o_palette.resize(8 * _dq.size());
+  for (unsigned int i = 0; i < _dq.size(); ++i) {
+    packDualQuat(_dq[i], &o_palette[8 * i]);
+  }
+}
+
+void packDualQuatPalette(const std::vector<ngl::Mat4> &_transforms, float *o_palette)
+{
+  DualQuaternion dq;
+  for (unsigned int i = 0; i < _transforms.size(); ++i) {
+    dq.fromMatrix(_transforms[i]);
+    packDualQuat(dq, &o_palette[8 * i]);
+  }
+}
+
+void skinLBS(
+              SimdLevel _level,
+              const skinInfluences &_influences,
+              const float *_palette,
+              const skinStreams &_streams,
+              unsigned int _begin,
+              unsigned int _end
+            )
+{
+  switch (_level) {
+#ifdef SKIN_X86_SIMD
+  case SIMD_AVX2 :
+    skinLBS_AVX2(_influences, _palette, _streams, _begin, _end);
+    break;
+  case SIMD_SSE2 :
+    skinLBS_SSE2(_influences, _palette, _streams, _begin, _end);
+    break;
+#endif
+  default :
+    skinLBS_Scalar(_influences, _palette, _streams, _begin, _end);
+    break;
+  }
+}
+
+void skinDQ(
+             SimdLevel _level,
+             const skinInfluences &_influences,
+             const float *_palette,
+             const skinStreams &_streams,
+             unsigned int _begin,
+             unsigned int _end
+           )
+{
+  switch (_level) {
+#ifdef SKIN_X86_SIMD
+  case SIMD_AVX2 :
+    skinDQ_AVX2(_influences, _palette, _streams, _begin, _end);
+    break;
+  case SIMD_SSE2 :
+    skinDQ_SSE2(_influences, _palette, _streams, _begin, _end);
+    break;
+#endif
+  default :
+    skinDQ_Scalar(_influences, _palette, _streams, _begin, _end);
+    break;
+  }
+}
+
+}
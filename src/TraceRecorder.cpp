@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TraceRecorder.cpp
+/// @brief member fucntions of class TraceRecorder
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include "TraceRecorder.h"
+#include<fstream>
+
+// about four minutes of the viewer at 50 frames per second
+const static unsigned int DEFAULT_CAPACITY = 1 << 18;
+
+TraceRecorder *TraceRecorder::instance()
+{
+  //created on first use,c++11 makes this thread safe
+  static TraceRecorder recorder;
+  return &recorder;
+}
+
+TraceRecorder::TraceRecorder()
+{
+  m_events.resize(DEFAULT_CAPACITY);
+  m_next = 0;
+  m_enabled = false;
+  m_origin = Clock::now();
+}
+
+void TraceRecorder::setCapacity(unsigned int _capacity)
+{
+  m_events.assign(_capacity > 0 ? _capacity : 1, traceEvent());
+  m_next = 0;
+}
+
+void TraceRecorder::clear()
+{
+  m_next = 0;
+}
+
+double TraceRecorder::now() const
+{
+  return std::chrono::duration<double, std::micro>(Clock::now() - m_origin).count();
+}
+
+unsigned int TraceRecorder::threadId()
+{
+  static std::atomic<unsigned int> nThreads(0);
+  thread_local unsigned int id = nThreads++;
+  return id;
+}
+
+void TraceRecorder::record(const char *_name, double _start, double _end)
+{
+  if (!m_enabled) {
+    return;
+  }
+  traceEvent &event = m_events[m_next++ % m_events.size()];
+  event.m_name = _name;
+  event.m_start = _start;
+  event.m_duration = _end - _start;
+  event.m_thread = threadId();
+}
+
+bool TraceRecorder::writeChromeTrace(const std::string &_fname)
+{
+  //copy the ring with recording paused so the spans are not overwritten while they are written out
+  bool wasEnabled = m_enabled.exchange(false);
+  unsigned long long total = m_next;
+  unsigned long long capacity = m_events.size();
+  unsigned long long first = total > capacity ? total - capacity : 0;
+  std::vector<traceEvent> events;
+  events.reserve(total - first);
+  for (unsigned long long i = first; i < total; ++i) {
+    events.push_back(m_events[i % capacity]);
+  }
+  m_enabled = wasEnabled;
+
+  std::ofstream file(_fname.c_str());
+  if (!file.is_open()) {
+    return false;
+  }
+  file.precision(3);
+  file << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  for (unsigned int i = 0; i < events.size(); ++i) {
+    const traceEvent &e = events[i];
+    file << "{\"name\":\"" << e.m_name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.m_thread
+         << ",\"ts\":" << e.m_start << ",\"dur\":" << e.m_duration << "}"
+         << (i + 1 < events.size() ? ",\n" : "\n");
+  }
+  file << "]}\n";
+  file.close();
+  return !file.fail();
+}
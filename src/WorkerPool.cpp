@@ -0,0 +1,135 @@
+//----------------------------------------------------------------------------------------------------------------------
+/// @file WorkerPool.cpp
+/// @brief member fucntions of class WorkerPool
+/// @author Prethish Bhasuran
+/// @version 1.0
+/// @date 12/9/14
+//----------------------------------------------------------------------------------------------------------------------
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(unsigned int _nThreads)
+{
+  m_job = 0;
+  m_count = 0;
+  m_nBlocks = 0;
+  m_generation = 0;
+  m_pending = 0;
+  m_quit = false;
+  startWorkers(_nThreads);
+}
+
+WorkerPool::~WorkerPool()
+{
+  stopWorkers();
+}
+
+void WorkerPool::setNumThreads(unsigned int _nThreads)
+{
+  stopWorkers();
+  startWorkers(_nThreads);
+}
+
+void WorkerPool::startWorkers(unsigned int _nThreads)
+{
+  if (_nThreads == 0) {
+    _nThreads = std::thread::hardware_concurrency();
+  }
+  if (_nThreads == 0) {
+    _nThreads = 1;
+  }
+  m_quit = false;
+  //block 0 is always run by the calling thread
+  for (unsigned int i = 1; i < _nThreads; ++i) {
+    m_workers.push_back(std::thread(&WorkerPool::workerLoop, this, i, m_generation));
+  }
+}
+
+void WorkerPool::stopWorkers()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  m_wake.notify_all();
+  for (unsigned int i = 0; i < m_workers.size(); ++i) {
+    m_workers[i].join();
+  }
+  m_workers.clear();
+}
+
+void WorkerPool::blockRange(unsigned int _block, unsigned int &o_begin, unsigned int &o_end) const
+{
+  //spread the remainder over the first blocks so they differ by one at most
+  unsigned int size = m_count / m_nBlocks;
+  unsigned int extra = m_count % m_nBlocks;
+  o_begin = _block * size + (_block < extra ? _block : extra);
+  o_end = o_begin + size + (_block < extra ? 1 : 0);
+}
+
+void WorkerPool::parallelFor(unsigned int _count, const RangeJob &_job, unsigned int _minBlock)
+{
+  if (_count == 0) {
+    return;
+  }
+  if (_minBlock == 0) {
+    _minBlock = 1;
+  }
+  unsigned int nBlocks = numThreads();
+  if (_count / _minBlock < nBlocks) {
+    nBlocks = _count / _minBlock;
+  }
+  //not worth waking anyone up
+  if (nBlocks <= 1) {
+    _job(0, _count);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_job = &_job;
+    m_count = _count;
+    m_nBlocks = nBlocks;
+    m_pending = m_workers.size();
+    ++m_generation;
+  }
+  m_wake.notify_all();
+
+  unsigned int begin, end;
+  blockRange(0, begin, end);
+  _job(begin, end);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (m_pending != 0) {
+    m_done.wait(lock);
+  }
+  m_job = 0;
+}
+
+void WorkerPool::workerLoop(unsigned int _block, unsigned int _generation)
+{
+  unsigned int seenGeneration = _generation;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    while (!m_quit && m_generation == seenGeneration) {
+      m_wake.wait(lock);
+    }
+    if (m_quit) {
+      return;
+    }
+    seenGeneration = m_generation;
+    const RangeJob *job = m_job;
+    bool hasBlock = _block < m_nBlocks;
+    unsigned int begin = 0, end = 0;
+    if (hasBlock) {
+      blockRange(_block, begin, end);
+    }
+    lock.unlock();
+    if (hasBlock) {
+      (*job)(begin, end);
+    }
+    lock.lock();
+    if (--m_pending == 0) {
+      m_done.notify_one();
+    }
+  }
+}